@@ -0,0 +1,251 @@
+// accum.hpp
+#pragma once
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "block_reduce.hpp"
+
+// ---------- Sum accumulator policies for CityResult ----------
+// Each policy exposes add(v), merge(other), total() and count(), the number
+// of values added; it keeps the count so that it can share a word with the
+// sum state. CityResult<Accum> picks one at compile time (see BRC_ACCUM in
+// city_result.hpp). A policy may also offer add_block(v, n), equal to n
+// add()s but free to split the work into independent chains;
+// CityResult::update_block uses it when present.
+
+// Plain double: fastest, but the result depends on summation and merge order.
+struct PlainSum {
+    static constexpr std::uint32_t kTag = 1;  // identifies the policy in checkpoints
+    double sum = 0.0;
+    int    n = 0;
+
+    void add(double v) noexcept {
+        sum += v;
+        n += 1;
+    }
+    // Four chains: a different rounding than n add()s, which this policy
+    // already accepts from merge order.
+    void add_block(const double* v, std::size_t n) noexcept {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            s0 += v[i];
+            s1 += v[i + 1];
+            s2 += v[i + 2];
+            s3 += v[i + 3];
+        }
+        for (; i < n; ++i) s0 += v[i];
+        sum += (s0 + s1) + (s2 + s3);
+        this->n += static_cast<int>(n);
+    }
+    void merge(const PlainSum& o) noexcept {
+        sum += o.sum;
+        n += o.n;
+    }
+    double total() const noexcept { return sum; }
+    int count() const noexcept { return n; }
+};
+
+// Neumaier-compensated double: error stays O(eps) independent of row count,
+// but the last bit can still move when merge order changes.
+struct NeumaierSum {
+    static constexpr std::uint32_t kTag = 2;
+    double sum  = 0.0;
+    double comp = 0.0;  // running compensation for lost low-order bits
+    int    n = 0;
+
+    void add(double v) noexcept {
+        const double t = sum + v;
+        if (std::fabs(sum) >= std::fabs(v)) comp += (sum - t) + v;
+        else                                comp += (v - t) + sum;
+        sum = t;
+        n += 1;
+    }
+    void merge(const NeumaierSum& o) noexcept {
+        const int total_n = n + o.n;
+        add(o.sum);
+        comp += o.comp;
+        n = total_n;
+    }
+    double total() const noexcept { return sum + comp; }
+    int count() const noexcept { return n; }
+};
+
+namespace accum_detail {
+
+constexpr double pow10d(int n) {
+    double s = 1.0;
+    for (int i = 0; i < n; ++i) s *= 10.0;
+    return s;
+}
+
+// The rounding error of s = x + y, exactly (Neumaier's branch on magnitude).
+inline double add_error(double x, double y, double s) noexcept {
+    return std::fabs(x) >= std::fabs(y) ? (x - s) + y : (y - s) + x;
+}
+
+// Integer units of 10^-Decimals while every term fits them, a compensated
+// double from the first term that does not: a station starts exact and
+// switches, once, when a term is out of range, would overflow the int64 sum,
+// or (for MixedSum) is not a value the scan proved fixed-point. Nothing is
+// ever wrapped or truncated; a switched station just is no longer exact.
+//
+// Two words, so that CityResult stays at 32 bytes and the station slot keeps
+// its 16-byte key prefix. The first holds the units while exact and the
+// double sum after the switch. The second holds the value count in its low
+// half; its high half is a tag while exact and, after the switch, the float
+// low part of the sum. The tag is a signalling-NaN pattern, which no float
+// conversion produces (those come out quiet). The pair is renormalized on
+// every add so that the low part only holds what lies below the sum's last
+// bit: rounding it to a float then costs 2^-24 of half an ulp per add, far
+// below the one rounding of the printed mean.
+template <int Decimals>
+struct ScaledUnits {
+    static_assert(Decimals >= 0 && Decimals <= 15, "scale must fit the int64 range");
+    static constexpr double        kScale = pow10d(Decimals);
+    static constexpr std::uint32_t kExact = 0x7f85c1edu;
+
+    std::uint64_t a = 0;                              // units, or the bits of the double sum
+    std::uint64_t b = std::uint64_t{kExact} << 32;    // kExact or the low part's float bits : count
+
+    bool exact() const noexcept { return (b >> 32) == kExact; }
+    std::int64_t units() const noexcept { return static_cast<std::int64_t>(a); }
+    int count() const noexcept { return static_cast<int>(static_cast<std::uint32_t>(b)); }
+
+    // Counts n more values (the count stays below 2^31, as an int counter did).
+    void counted(std::size_t n) noexcept { b += n; }
+
+    // Adds units while exact; switches first when the sum would overflow.
+    void push(std::int64_t u) noexcept {
+        std::int64_t s;
+        if (exact() && !__builtin_add_overflow(units(), u, &s)) a = static_cast<std::uint64_t>(s);
+        else spill(static_cast<double>(u) / kScale);
+    }
+    // Adds v as a double, switching first if still exact.
+    void spill(double v) noexcept { spill_block(&v, 1); }
+    // Adds v[0..n) as doubles: the pair is unpacked once, summed with a
+    // double low part and renormalized at the end.
+    void spill_block(const double* v, std::size_t n) noexcept {
+        if (exact()) set(static_cast<double>(units()) / kScale, 0.0f);
+        double hi = std::bit_cast<double>(a), lo = static_cast<double>(low());
+        for (std::size_t i = 0; i < n; ++i) {
+            const double t = hi + v[i];
+            lo += add_error(hi, v[i], t);
+            hi = t;
+        }
+        // Fast2Sum: exact while |lo| <= |hi|, and off by less than lo's own
+        // last bit when cancellation has left hi smaller
+        const double u = hi + lo;
+        set(u, static_cast<float>(lo - (u - hi)));
+    }
+
+    // A value parsed as exactly u * 10^-N (parse_fixed: |u| < 10^15): exact,
+    // and equal to adding u / 10^N.
+    template <int N>
+        requires (N <= Decimals)
+    void add_units(std::int64_t u) noexcept {
+        add_units_uncounted<N>(u);
+        counted(1);
+    }
+    // n add_units<N>() calls, the u summed in vector chains. With |u| < 10^15
+    // a piece of 8192 cannot overflow the partial sum.
+    template <int N>
+        requires (N <= Decimals)
+    void add_units_block(const std::int64_t* u, std::size_t n) noexcept {
+        if (!exact()) {
+            for (std::size_t i = 0; i < n; ++i) spill(static_cast<double>(u[i]) / pow10d(N));   // rare: a switched station
+        } else {
+            for (std::size_t i = 0; i < n; i += 8192) add_units_uncounted<N>(block_sum(u + i, n - i < 8192 ? n - i : 8192));
+        }
+        counted(n);
+    }
+    void merge(const ScaledUnits& o) noexcept {
+        if (o.exact()) {
+            push(o.units());
+        } else {
+            spill(std::bit_cast<double>(o.a));
+            spill(static_cast<double>(o.low()));
+        }
+        counted(static_cast<std::size_t>(o.count()));
+    }
+    double total() const noexcept {
+        return exact() ? static_cast<double>(units()) / kScale : std::bit_cast<double>(a) + static_cast<double>(low());
+    }
+
+private:
+    float low() const noexcept { return std::bit_cast<float>(static_cast<std::uint32_t>(b >> 32)); }
+    void set(double hi, float lo) noexcept {
+        a = std::bit_cast<std::uint64_t>(hi);
+        b = std::uint64_t{std::bit_cast<std::uint32_t>(lo)} << 32 | static_cast<std::uint32_t>(b);
+    }
+
+    template <int N>
+    void add_units_uncounted(std::int64_t u) noexcept {
+        std::int64_t m = 1, t;
+        for (int i = N; i < Decimals; ++i) m *= 10;
+        if (exact() && !__builtin_mul_overflow(u, m, &t)) push(t);
+        else spill(static_cast<double>(u) / pow10d(N));
+    }
+};
+
+}  // namespace accum_detail
+
+// Scaled-integer fixed point for bounded-precision input: every value is
+// rounded once to a multiple of 10^-Decimals and summed as int64, so sums
+// and merges are exact and bit-identical in any order. Values with at most
+// Decimals decimals (e.g. the one-decimal 1BRC format) are represented
+// exactly; longer ones lose what lies past the scale. A value that is not
+// finite or whose units reach 2^53, or a sum that would overflow, switches
+// the station to a compensated double (see ScaledUnits).
+template <int Decimals>
+struct FixedSum : accum_detail::ScaledUnits<Decimals> {
+    using Base = accum_detail::ScaledUnits<Decimals>;
+    static constexpr std::uint32_t kTag = 0x300 + Decimals;
+    static constexpr double kMaxTerm = 9007199254740992.0;   // 2^53
+
+    // Round half away from zero with a truncating convert: inlines to two
+    // instructions, where std::llrint is a libm call. NaN fails the compare.
+    void add(double v) noexcept {
+        const double x = v * Base::kScale;
+        if (Base::exact() && std::fabs(x) < kMaxTerm) Base::push(static_cast<std::int64_t>(x + std::copysign(0.5, x)));
+        else Base::spill(v);
+        Base::counted(1);
+    }
+    // Same as n add()s. Pieces of 256 terms below 2^53 cannot overflow the
+    // partial sum; a piece holding an out-of-range term goes value by value.
+    void add_block(const double* v, std::size_t n) noexcept {
+        for (std::size_t i = 0; i < n; i += 256) {
+            const std::size_t k = n - i < 256 ? n - i : 256;
+            std::int64_t s;
+            if (Base::exact() && block_round_sum(v + i, k, Base::kScale, kMaxTerm, s)) {
+                Base::push(s);
+                Base::counted(k);
+            } else for (std::size_t j = i; j < i + k; ++j) add(v[j]);
+        }
+    }
+    void merge(const FixedSum& o) noexcept { Base::merge(o); }
+};
+
+// The default: exact where the input proved it, double everywhere else.
+// Values a scan kernel parsed as fixed N-decimal (add_units, N <= Decimals)
+// sum as exact integer units, so for such input the result is bit-identical
+// in any chunk and merge order. Any other value is added unchanged to a
+// compensated double, so full-precision, huge and non-finite values keep double
+// semantics instead of being rounded to a scale.
+template <int Decimals>
+struct MixedSum : accum_detail::ScaledUnits<Decimals> {
+    using Base = accum_detail::ScaledUnits<Decimals>;
+    static constexpr std::uint32_t kTag = 0x200 + Decimals;
+
+    void add(double v) noexcept {
+        Base::spill(v);
+        Base::counted(1);
+    }
+    void add_block(const double* v, std::size_t n) noexcept {
+        Base::spill_block(v, n);
+        Base::counted(n);
+    }
+    void merge(const MixedSum& o) noexcept { Base::merge(o); }
+};
@@ -0,0 +1,348 @@
+// bench.cpp
+// Benchmark driver: runs every engine binary over a matrix of generated
+// datasets and writes one CSV row per (engine, dataset) with median wall time,
+// its spread, throughput, peak RSS and hardware counters.
+//
+//   ./bench [--rows 1M,10M] [--stations 100,10k,1M] [--keylen short,long]
+//           [--order sorted,shuffled,zipf] [--repeats 5] [--warmup 1]
+//           [--engine name=./binary ...] [--data-dir bench_data] [--out bench_results.csv]
+//
+// Each engine is run with its working directory set to the dataset directory,
+// where it finds test_sample.txt and writes test_sample_results_calculated.txt
+// (the contract every solution_* binary already follows). The output is checked
+// against the truth the generator computed, with the same 1e-5 tolerance as
+// evaluate_test.py.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "generate.hpp"
+
+// ---------- Dataset shapes ----------
+struct Shape {
+    std::uint64_t rows;
+    std::uint32_t stations;
+    std::string   keylen;   // "short": 3-12 bytes, "long": 16-64 bytes
+    std::string   order;    // "sorted" (grouped by station), "shuffled" or "zipf"
+
+    std::string dir(const std::string& root) const {
+        return root + "/r" + std::to_string(rows) + "_s" + std::to_string(stations) + "_" + keylen + "_" + order;
+    }
+};
+
+// Writes test_sample.txt and test_sample_results_truth.txt into dir.
+static bool generate(const Shape& shape, const std::string& dir) {
+    GenConfig cfg;
+    cfg.rows = shape.rows;
+    cfg.stations = shape.stations;
+    cfg.name_min = shape.keylen == "long" ? 16 : 3;
+    cfg.name_max = shape.keylen == "long" ? 64 : 12;
+    cfg.order = shape.order == "sorted" ? RowOrder::Sorted
+              : shape.order == "zipf"   ? RowOrder::Zipf : RowOrder::Shuffled;
+    cfg.seed = 42 + shape.rows + shape.stations;
+    cfg.out = dir + "/test_sample.txt";
+    cfg.truth = dir + "/test_sample_results_truth.txt";
+    return generate_samples(cfg);
+}
+
+// ---------- Result check (evaluate_test.py semantics) ----------
+using Stats = std::unordered_map<std::string, std::vector<double>>;
+
+static bool read_stats(const std::string& path, Stats& out) {
+    FILE* fp = std::fopen(path.c_str(), "r");
+    if (!fp) return false;
+    char* line = nullptr;
+    std::size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &cap, fp)) != -1) {
+        std::string_view l(line, static_cast<std::size_t>(len));
+        while (!l.empty() && (l.back() == '\n' || l.back() == '\r')) l.remove_suffix(1);
+        std::size_t sep = l.find(';');
+        if (sep == std::string_view::npos) continue;
+        std::vector<double>& v = out[std::string(l.substr(0, sep))];
+        for (std::size_t p = sep + 1; p <= l.size();) {
+            std::size_t q = l.find(';', p);
+            if (q == std::string_view::npos) q = l.size();
+            v.push_back(std::strtod(std::string(l.substr(p, q - p)).c_str(), nullptr));
+            p = q + 1;
+        }
+    }
+    std::free(line);
+    std::fclose(fp);
+    return true;
+}
+
+static std::string output_path(const std::string& dir) { return dir + "/test_sample_results_calculated.txt"; }
+
+// Reads the output of the run just made: run_once removes the previous one
+// first, so an engine that writes nothing fails instead of passing on a
+// stale file.
+static bool check_output(const std::string& dir) {
+    Stats truth, calc;
+    if (!read_stats(dir + "/test_sample_results_truth.txt", truth)) return false;
+    if (!read_stats(output_path(dir), calc)) return false;
+    for (const auto& [city, t] : truth) {
+        auto it = calc.find(city);
+        if (it == calc.end() || it->second.size() < 3) return false;
+        for (int i = 0; i < 3; ++i) {
+            if (std::fabs(t[i] - it->second[i]) > 1e-5) return false;
+        }
+    }
+    return true;
+}
+
+// ---------- Hardware counters ----------
+struct Counter {
+    const char*   name;
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+static const Counter kCounters[] = {
+    {"cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache_misses",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"page_faults",   PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+constexpr std::size_t kNumCounters = sizeof kCounters / sizeof kCounters[0];
+
+// Opened on the (stopped) child before exec; enable_on_exec + inherit makes
+// them count the engine and all of its threads, nothing of the fork glue.
+static int open_counter(const Counter& c, pid_t pid) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = c.type;
+    attr.config = c.config;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = c.type == PERF_TYPE_HARDWARE;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0));
+}
+
+// Scaled for multiplexing; -1 when the counter is unavailable.
+static double read_counter(int fd) {
+    if (fd < 0) return -1.0;
+    std::uint64_t v[3] = {0, 0, 0};
+    if (::read(fd, v, sizeof v) != static_cast<ssize_t>(sizeof v) || v[2] == 0) return -1.0;
+    return static_cast<double>(v[0]) * static_cast<double>(v[1]) / static_cast<double>(v[2]);
+}
+
+// ---------- One run ----------
+struct Sample {
+    double wall_s = 0.0;
+    double peak_rss_mb = 0.0;
+    double counters[kNumCounters];
+    bool   exited_ok = false;
+};
+
+static Sample run_once(const std::string& binary, const std::string& dir) {
+    Sample s;
+    ::unlink(output_path(dir).c_str());
+    int gate[2];
+    if (::pipe(gate) != 0) { std::perror("pipe"); return s; }
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        ::close(gate[1]);
+        char go;
+        if (::read(gate[0], &go, 1) != 1) _exit(126);
+        if (::chdir(dir.c_str()) != 0) _exit(126);
+        int devnull = ::open("/dev/null", O_WRONLY);
+        if (devnull >= 0) { ::dup2(devnull, 1); ::dup2(devnull, 2); }
+        ::execl(binary.c_str(), binary.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    ::close(gate[0]);
+
+    int fds[kNumCounters];
+    for (std::size_t i = 0; i < kNumCounters; ++i) fds[i] = open_counter(kCounters[i], pid);
+
+    auto t0 = std::chrono::steady_clock::now();
+    (void)!::write(gate[1], "x", 1);
+    ::close(gate[1]);
+
+    int status = 0;
+    struct rusage ru;
+    ::wait4(pid, &status, 0, &ru);
+    auto t1 = std::chrono::steady_clock::now();
+
+    s.wall_s = std::chrono::duration<double>(t1 - t0).count();
+    s.peak_rss_mb = static_cast<double>(ru.ru_maxrss) / 1024.0;  // KiB on Linux
+    s.exited_ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    for (std::size_t i = 0; i < kNumCounters; ++i) {
+        s.counters[i] = read_counter(fds[i]);
+        if (fds[i] >= 0) ::close(fds[i]);
+    }
+    return s;
+}
+
+// ---------- Driver ----------
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    const std::size_t n = v.size();
+    return n == 0 ? 0.0 : n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+static double stddev(const std::vector<double>& v) {
+    if (v.size() < 2) return 0.0;
+    double m = 0.0;
+    for (double x : v) m += x;
+    m /= static_cast<double>(v.size());
+    double ss = 0.0;
+    for (double x : v) ss += (x - m) * (x - m);
+    return std::sqrt(ss / static_cast<double>(v.size() - 1));
+}
+
+// "1M,10k,250" -> {1000000, 10000, 250}; false if any entry is not a count
+static bool parse_counts(std::string_view list, std::vector<std::uint64_t>& out) {
+    out.clear();
+    for (;;) {
+        std::size_t comma = list.find(',');
+        std::uint64_t n = 0;
+        if (!parse_count(list.substr(0, comma), n)) return false;
+        out.push_back(n);
+        if (comma == std::string_view::npos) return true;
+        list.remove_prefix(comma + 1);
+    }
+}
+
+static std::vector<std::string> parse_words(std::string_view list) {
+    std::vector<std::string> out;
+    while (!list.empty()) {
+        std::size_t comma = list.find(',');
+        out.emplace_back(list.substr(0, comma));
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+    return out;
+}
+
+struct Engine {
+    std::string name;
+    std::string binary;   // absolute path, since engines run in the dataset dir
+};
+
+int main(int argc, char** argv) {
+    std::vector<std::uint64_t> rows = {1000000, 10000000};
+    std::vector<std::uint64_t> stations = {100, 10000, 1000000};
+    std::vector<std::string> keylens = {"short", "long"};
+    std::vector<std::string> orders = {"sorted", "shuffled"};
+    std::vector<Engine> engines;
+    int repeats = 5, warmup = 1;
+    std::string data_dir = "bench_data", out_path = "bench_results.csv";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        std::uint64_t n = 0;
+        if (a == "--rows" && v && parse_counts(v, rows)) ++i;
+        else if (a == "--stations" && v && parse_counts(v, stations)) ++i;
+        else if (a == "--keylen" && v) { keylens = parse_words(v); ++i; }
+        else if (a == "--order" && v) { orders = parse_words(v); ++i; }
+        else if (a == "--repeats" && v && parse_uint(v, 1000, n) && n > 0) { repeats = static_cast<int>(n); ++i; }
+        else if (a == "--warmup" && v && parse_uint(v, 1000, n)) { warmup = static_cast<int>(n); ++i; }
+        else if (a == "--data-dir" && v) { data_dir = v; ++i; }
+        else if (a == "--out" && v) { out_path = v; ++i; }
+        else if (a == "--engine" && v) {
+            std::string_view e = v;
+            std::size_t eq = e.find('=');
+            if (eq == std::string_view::npos) { std::fprintf(stderr, "--engine wants name=path\n"); return 2; }
+            engines.push_back({std::string(e.substr(0, eq)), std::string(e.substr(eq + 1))});
+            ++i;
+        } else {
+            std::fprintf(stderr, "unknown or malformed argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (engines.empty()) {
+        std::fprintf(stderr, "no engines given (use --engine name=./binary)\n");
+        return 2;
+    }
+    for (Engine& e : engines) {
+        char* abs = ::realpath(e.binary.c_str(), nullptr);
+        if (!abs) { std::perror(e.binary.c_str()); return 2; }
+        e.binary = abs;
+        std::free(abs);
+    }
+
+    FILE* csv = std::fopen(out_path.c_str(), "w");
+    if (!csv) { std::perror(out_path.c_str()); return 1; }
+    std::fprintf(csv, "engine,rows,stations,keylen,order,bytes,repeats,wall_median_s,wall_stddev_s,"
+                      "rows_per_s,gb_per_s,peak_rss_mb");
+    for (const Counter& c : kCounters) std::fprintf(csv, ",%s", c.name);
+    std::fprintf(csv, ",ipc,ok\n");
+
+    ::mkdir(data_dir.c_str(), 0755);
+    for (std::uint64_t r : rows)
+    for (std::uint64_t st : stations)
+    for (const std::string& kl : keylens)
+    for (const std::string& ord : orders) {
+        Shape shape{r, static_cast<std::uint32_t>(std::min<std::uint64_t>(st, r)), kl, ord};
+        const std::string dir = shape.dir(data_dir);
+        struct stat sb;
+        if (::stat((dir + "/test_sample_results_truth.txt").c_str(), &sb) != 0) {
+            std::fprintf(stderr, "generating %s\n", dir.c_str());
+            ::mkdir(dir.c_str(), 0755);
+            if (!generate(shape, dir)) return 1;
+        }
+        ::stat((dir + "/test_sample.txt").c_str(), &sb);
+        const double bytes = static_cast<double>(sb.st_size);
+
+        for (const Engine& e : engines) {
+            for (int w = 0; w < warmup; ++w) run_once(e.binary, dir);
+
+            std::vector<double> wall, rss, ctr[kNumCounters];
+            bool ok = true;
+            for (int k = 0; k < repeats; ++k) {
+                Sample s = run_once(e.binary, dir);
+                ok = ok && s.exited_ok && check_output(dir);
+                wall.push_back(s.wall_s);
+                rss.push_back(s.peak_rss_mb);
+                for (std::size_t i = 0; i < kNumCounters; ++i) ctr[i].push_back(s.counters[i]);
+            }
+
+            const double t = median(wall);
+            std::fprintf(csv, "%s,%llu,%u,%s,%s,%.0f,%d,%.6f,%.6f,%.0f,%.4f,%.1f", e.name.c_str(),
+                         static_cast<unsigned long long>(shape.rows), shape.stations, kl.c_str(), ord.c_str(),
+                         bytes, repeats, t, stddev(wall), static_cast<double>(shape.rows) / t, bytes / t / 1e9,
+                         median(rss));
+            double med[kNumCounters];
+            for (std::size_t i = 0; i < kNumCounters; ++i) {
+                med[i] = median(ctr[i]);
+                if (med[i] < 0) std::fprintf(csv, ",");
+                else            std::fprintf(csv, ",%.0f", med[i]);
+            }
+            if (med[0] > 0 && med[1] > 0) std::fprintf(csv, ",%.3f", med[1] / med[0]);
+            else                          std::fprintf(csv, ",");
+            std::fprintf(csv, ",%d\n", ok ? 1 : 0);
+            std::fflush(csv);
+
+            std::fprintf(stderr, "%-14s %-40s %9.3f s (+/- %.3f) %7.2f GB/s %s\n", e.name.c_str(),
+                         dir.c_str(), t, stddev(wall), bytes / t / 1e9, ok ? "ok" : "FAIL");
+        }
+    }
+    std::fclose(csv);
+    return 0;
+}
@@ -0,0 +1,229 @@
+// bench_accum.cpp
+// Checks the policies on values that do not fit a scaled int64 (huge, NaN,
+// overflowing sums), then the hot-path cost of each CityResult<Accum> policy,
+// and whether merging the same per-chunk partials in different orders gives
+// bit-identical sums. Then the
+// per-row update against run batching (update_block) on sorted and shuffled
+// station orders.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "city_result.hpp"
+
+template <class F>
+static double time_ms(F&& f) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+static std::uint64_t bits_of(double d) {
+    std::uint64_t b;
+    std::memcpy(&b, &d, sizeof b);
+    return b;
+}
+
+template <class Accum>
+static void run(const char* label, const std::vector<double>& values,
+                const std::vector<std::uint8_t>& station) {
+    constexpr std::size_t kStations = 100;
+    constexpr std::size_t kChunks = 64;
+
+    // Hot path: one update per row into a small table, as the scan kernel does.
+    std::vector<CityResult<Accum>> table(kStations);
+    double ms = time_ms([&] {
+        for (std::size_t i = 0; i < values.size(); ++i) table[station[i]].update(values[i]);
+    });
+    double check = 0.0;
+    for (const auto& cr : table) check += cr.mean();
+
+    // Merge determinism: same chunk partials, three merge orders.
+    std::vector<CityResult<Accum>> parts(kChunks);
+    const std::size_t per = values.size() / kChunks;
+    for (std::size_t c = 0; c < kChunks; ++c) {
+        for (std::size_t i = c * per; i < (c + 1) * per; ++i) parts[c].update(values[i]);
+    }
+    std::vector<std::size_t> order(kChunks);
+    for (std::size_t i = 0; i < kChunks; ++i) order[i] = i;
+    auto merged = [&] {
+        CityResult<Accum> r;
+        for (std::size_t c : order) r.merge(parts[c]);
+        return bits_of(r.sum());
+    };
+    std::uint64_t fwd = merged();
+    std::reverse(order.begin(), order.end());
+    std::uint64_t rev = merged();
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(7));
+    std::uint64_t shuf = merged();
+    const bool stable = fwd == rev && fwd == shuf;
+
+    std::printf("%-14s %10.1f %10.2f %14s  (mean-check %.6f)\n", label, ms,
+                values.size() / ms / 1e3, stable ? "bit-exact" : "order-dependent", check);
+}
+
+// The per-row update as it was before it went branchless, for comparison.
+struct BranchyResult {
+    double min = 1e300, max = -1e300;
+    int counter = 0;
+    FixedSum<6> acc;
+    void update(double v) noexcept {
+        if (v < min) min = v;
+        if (v > max) max = v;
+        acc.add(v);
+        counter += 1;
+    }
+    double mean() const noexcept { return acc.total() / counter; }
+};
+
+// Rows to table[station[i]]: per row, or batched per run of one station into
+// blocks of 64 the way run_kernel does.
+static void run_batching(const char* order, const std::vector<double>& values,
+                         const std::vector<std::uint8_t>& station) {
+    constexpr std::size_t kStations = 100, kBlock = 64;
+    double check[3] = {};
+
+    std::vector<BranchyResult> branchy(kStations);
+    const double ms_branchy = time_ms([&] {
+        for (std::size_t i = 0; i < values.size(); ++i) branchy[station[i]].update(values[i]);
+    });
+    for (const auto& cr : branchy) check[0] += cr.mean();
+
+    std::vector<CityResult<FixedSum<6>>> row(kStations);
+    const double ms_row = time_ms([&] {
+        for (std::size_t i = 0; i < values.size(); ++i) row[station[i]].update(values[i]);
+    });
+    for (const auto& cr : row) check[1] += cr.mean();
+
+    std::vector<CityResult<FixedSum<6>>> batched(kStations);
+    const double ms_batched = time_ms([&] {
+        alignas(64) double buf[kBlock];
+        std::size_t n = 0;
+        std::uint8_t cur = station.empty() ? 0 : station[0];
+        CityResult<FixedSum<6>>* slot = &batched[cur];
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            if (station[i] != cur) {
+                if (n == 1) slot->update(buf[0]);
+                else slot->update_block(buf, n);
+                n = 0;
+                cur = station[i];
+                slot = &batched[cur];
+            }
+            buf[n] = values[i];
+            if (++n == kBlock) {
+                slot->update_block(buf, n);
+                n = 0;
+            }
+        }
+        slot->update_block(buf, n);
+    });
+    for (const auto& cr : batched) check[2] += cr.mean();
+
+    const double rows = static_cast<double>(values.size());
+    std::printf("%-10s %12.2f %12.2f %12.2f  %s\n", order, rows / ms_branchy / 1e3, rows / ms_row / 1e3,
+                rows / ms_batched / 1e3, check[0] == check[1] && check[1] == check[2] ? "same" : "MISMATCH");
+}
+
+// Values a scaled int64 cannot hold must come out as a double sum would,
+// not rounded, wrapped or truncated. Returns the number of failures.
+template <class Accum>
+static int edge_cases(const char* label) {
+    int bad = 0;
+    auto expect = [&](const char* what, double got, double want) {
+        const bool ok = std::isnan(want) ? std::isnan(got) : got == want;
+        if (!ok) {
+            std::printf("[%s] %s: got %.17g want %.17g\n", label, what, got, want);
+            ++bad;
+        }
+    };
+    {
+        CityResult<Accum> r;
+        r.update(1e13);
+        r.update(1e13);
+        expect("2 x 1e13, mean", r.mean(), 1e13);
+    }
+    {
+        CityResult<Accum> r;
+        r.update(12345678901234567890.0);
+        expect("1.2e19, mean", r.mean(), 12345678901234567890.0);
+    }
+    {
+        CityResult<Accum> r;
+        r.update(1.5);
+        r.update(std::nan(""));
+        expect("NaN row, mean", r.mean(), std::nan(""));
+        expect("NaN row, min", r.min, 1.5);
+    }
+    {
+        const double v[5] = {1.25, -2.5, 1e300, -std::numeric_limits<double>::infinity(), 3.0};
+        CityResult<Accum> rows, block;
+        for (double x : v) rows.update(x);
+        block.update_block(v, 5);
+        expect("block with 1e300 and -inf, sum", block.sum(), rows.sum());
+    }
+    if constexpr (requires(Accum a) { a.template add_units<1>(1); }) {
+        // 20000 x 9e13 overflows int64 units at any scale >= 10^-2
+        CityResult<Accum> r, s;
+        for (int i = 0; i < 10000; ++i) {
+            r.template update_units<1>(9e13, 900'000'000'000'000);
+            s.template update_units<1>(9e13, 900'000'000'000'000);
+        }
+        r.merge(s);
+        expect("units sum past int64, mean", r.mean(), 9e13);
+        CityResult<Accum> t;
+        const std::int64_t u[3] = {-15, 25, 7};
+        const double v[3] = {-1.5, 2.5, 0.7};
+        t.template update_units_block<1>(v, u, 3);
+        expect("units block, sum", t.sum(), 1.7);
+    }
+    return bad;
+}
+
+int main() {
+    int bad = edge_cases<PlainSum>("plain") + edge_cases<NeumaierSum>("neumaier") +
+              edge_cases<MixedSum<2>>("mixed<2>") + edge_cases<FixedSum<6>>("fixed<6>") +
+              edge_cases<FixedSum<9>>("fixed<9>");
+    if (bad) {
+        std::printf("FAIL: %d edge cases\n", bad);
+        return 1;
+    }
+    std::printf("OK: huge, NaN and overflowing values sum as doubles under every policy\n\n");
+
+    constexpr std::size_t kRows = 50'000'000;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> uni(-10.0, 50.0);
+    std::vector<double> values(kRows);
+    std::vector<std::uint8_t> station(kRows);
+    for (std::size_t i = 0; i < kRows; ++i) {
+        values[i] = uni(rng);
+        station[i] = static_cast<std::uint8_t>(rng() % 100);
+    }
+
+    std::printf("%-14s %10s %10s %14s\n", "policy", "update_ms", "Mrows/s", "merge");
+    run<PlainSum>("plain", values, station);
+    run<NeumaierSum>("neumaier", values, station);
+    run<MixedSum<2>>("mixed<2>", values, station);
+    run<FixedSum<6>>("fixed<6>", values, station);
+    run<FixedSum<9>>("fixed<9>", values, station);
+
+    // Same rows, fixed<6>: station order as drawn, and sorted by station.
+    std::printf("\n%-10s %12s %12s %12s  (Mrows/s)\n", "order", "branchy", "branchless", "run-batched");
+    run_batching("shuffled", values, station);
+    std::vector<std::size_t> idx(kRows);
+    for (std::size_t i = 0; i < kRows; ++i) idx[i] = i;
+    std::stable_sort(idx.begin(), idx.end(), [&](std::size_t a, std::size_t b) { return station[a] < station[b]; });
+    std::vector<double> sorted_values(kRows);
+    std::vector<std::uint8_t> sorted_station(kRows);
+    for (std::size_t i = 0; i < kRows; ++i) {
+        sorted_values[i] = values[idx[i]];
+        sorted_station[i] = station[idx[i]];
+    }
+    run_batching("sorted", sorted_values, sorted_station);
+    return 0;
+}
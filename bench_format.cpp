@@ -0,0 +1,139 @@
+// bench_format.cpp
+// Differential check and timing for the result writer: format_fixed vs
+// snprintf("%.*f") byte for byte, the radix name sort vs std::sort, and the
+// whole file for 1M stations through format_results vs the old per-field
+// snprintf + stdio path. Any mismatch fails the run.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "format_results.hpp"
+#include "station_table.hpp"
+
+template <class F>
+static double time_ms(F&& f) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+static std::size_t check_fixed(double v, int d) {
+    char a[512], b[512];
+    char* end = format_fixed(a, v, d);
+    const int n = std::snprintf(b, sizeof b, "%.*f", d, v);
+    if (end - a == n && std::memcmp(a, b, static_cast<std::size_t>(n)) == 0) return 0;
+    std::fprintf(stderr, "mismatch %.17g d=%d: got %.*s want %s\n", v, d, static_cast<int>(end - a), a, b);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> uni(-100.0, 100.0);
+    std::uniform_int_distribution<std::uint64_t> any_bits;
+    std::size_t bad = 0;
+
+    // Values of result-file shape, random bit patterns, exact ties at every
+    // precision (k + 1/2) / 10^d with power-of-two denominators, and edges.
+    for (std::size_t i = 0; i < n; ++i) {
+        const int d = static_cast<int>(i % 21);
+        bad += check_fixed(uni(rng), d);
+        double w;
+        std::uint64_t bits = any_bits(rng);
+        std::memcpy(&w, &bits, sizeof w);
+        bad += check_fixed(w, d);
+        bad += check_fixed(std::ldexp(static_cast<double>(rng() % 2001) - 1000.0, -static_cast<int>(rng() % 12)), d % 12);
+    }
+    const double edges[] = {0.0, -0.0, 0.5, -0.5, 1.5, 2.5, 1e-300, -1e-300, 5e-324, 1e19, 1.8446744073709552e19,
+                            9.999999999999999e18, 1e300, INFINITY, -INFINITY, NAN};
+    for (double e : edges) {
+        for (int d = 0; d <= 20; ++d) bad += check_fixed(e, d);
+    }
+
+    // Name sort: shared prefixes past the 8-byte window, multi-byte UTF-8
+    std::vector<std::string> names;
+    std::uniform_int_distribution<int> len(1, 40);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::string s = i % 3 == 0 ? "Saint Petersburg " : i % 3 == 1 ? "S\xC3\xA3o " : "";
+        for (int k = len(rng); k > 0; --k) s.push_back(static_cast<char>(rng() % 4 ? 'a' + rng() % 26 : 0xC3));
+        names.push_back(std::move(s));
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    std::shuffle(names.begin(), names.end(), rng);
+
+    std::vector<NamedResult<int>> items;
+    for (const std::string& s : names) items.push_back({0, s, nullptr});
+    std::vector<NamedResult<int>> ref = items;
+    double ms_std = time_ms([&] {
+        std::sort(ref.begin(), ref.end(), [](const auto& x, const auto& y) { return x.name < y.name; });
+    });
+    double ms_radix = time_ms([&] { sort_by_name(items); });
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (items[i].name != ref[i].name) { std::fprintf(stderr, "sort mismatch at %zu\n", i); ++bad; break; }
+    }
+
+    // Whole result file for every generated name
+    StationTable<SvHash> table(names.size() * 2);
+    for (const std::string& s : names) {
+        CityResult<>& r = table.upsert(s);
+        for (int k = 0; k < 4; ++k) r.update(uni(rng));
+    }
+    double ms_stdio = time_ms([&] {
+        FILE* out = std::fopen("/tmp/bench_format_stdio.txt", "w");
+        char num[64];
+        table.for_each([&](std::string_view city, const CityResult<>& cr) {
+            std::fwrite(city.data(), 1, city.size(), out);
+            std::fputc(';', out);
+            int k = std::snprintf(num, sizeof num, "%.8f", cr.mean());
+            std::fwrite(num, 1, static_cast<std::size_t>(k), out);
+            std::fputc(';', out);
+            k = std::snprintf(num, sizeof num, "%.8f", cr.min);
+            std::fwrite(num, 1, static_cast<std::size_t>(k), out);
+            std::fputc(';', out);
+            k = std::snprintf(num, sizeof num, "%.8f", cr.max);
+            std::fwrite(num, 1, static_cast<std::size_t>(k), out);
+            std::fputc('\n', out);
+        });
+        std::fclose(out);
+    });
+    double ms_fmt = time_ms([&] { write_results_file(table, "/tmp/bench_format_fast.txt", FormatOptions{}); });
+    double ms_sorted = time_ms([&] {
+        FormatOptions fo;
+        fo.sorted = true;
+        write_results_file(table, "/tmp/bench_format_sorted.txt", fo);
+    });
+
+    FILE* a = std::fopen("/tmp/bench_format_stdio.txt", "r");
+    FILE* b = std::fopen("/tmp/bench_format_fast.txt", "r");
+    for (int ca = 0, cb = 0; a && b && ca != EOF;) {
+        ca = std::fgetc(a);
+        cb = std::fgetc(b);
+        if (ca != cb) { std::fprintf(stderr, "result file mismatch\n"); ++bad; break; }
+    }
+    if (a) std::fclose(a);
+    if (b) std::fclose(b);
+    std::remove("/tmp/bench_format_stdio.txt");
+    std::remove("/tmp/bench_format_fast.txt");
+    std::remove("/tmp/bench_format_sorted.txt");
+
+    std::printf("%-22s %10zu names\n", "stations", names.size());
+    std::printf("%-22s %10.1f ms\n", "std::sort", ms_std);
+    std::printf("%-22s %10.1f ms  (%.2fx)\n", "radix sort", ms_radix, ms_std / ms_radix);
+    std::printf("%-22s %10.1f ms\n", "snprintf + stdio", ms_stdio);
+    std::printf("%-22s %10.1f ms  (%.2fx)\n", "format_results", ms_fmt, ms_stdio / ms_fmt);
+    std::printf("%-22s %10.1f ms\n", "format_results sorted", ms_sorted);
+
+    if (bad) {
+        std::fprintf(stderr, "%zu mismatches\n", bad);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// bench_hash.cpp
+// Hash policies against dataset shapes: for each (shape, hash) pair, a stream
+// of upserts over "name;" records laid out like the input, hashed in place
+// with hash_bounded, then the probe-length and collision profile of the
+// resulting table. Also checks that hash_bounded and hash_scan agree with
+// Hash{}(key) on every name, since the table mixes all three.
+//
+//   ./bench_hash [rows=10000000] [-v]   (-v prints the full histograms)
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "generate.hpp"
+#include "station_table.hpp"
+
+struct Shape {
+    const char*              name;
+    std::vector<std::string> keys;
+};
+
+static std::vector<std::string> random_names(std::uint32_t n, std::uint32_t lo, std::uint32_t hi) {
+    GenConfig cfg;
+    cfg.stations = n;
+    cfg.name_min = lo;
+    cfg.name_max = hi;
+    return gen_detail::make_names(cfg);
+}
+
+static std::vector<Shape> make_shapes() {
+    std::vector<Shape> shapes;
+    Shape cities{"cities", {}};
+    for (const char* c : kCities) cities.keys.emplace_back(c);
+    shapes.push_back(std::move(cities));
+    shapes.push_back({"short 3-8", random_names(10'000, 3, 8)});
+    shapes.push_back({"mixed 3-24", random_names(100'000, 3, 24)});
+    shapes.push_back({"long 16-64", random_names(100'000, 16, 64)});
+    // Names that only differ after a long common prefix
+    Shape prefix{"prefix+num", {}};
+    for (std::uint32_t i = 0; i < 100'000; ++i) prefix.keys.push_back("Weather station no. " + std::to_string(i));
+    shapes.push_back(std::move(prefix));
+    return shapes;
+}
+
+template <class Hash>
+static bool check(const Shape& sh) {
+    for (const std::string& k : sh.keys) {
+        std::string rec = k + ";12.3\n" + std::string(16, 'x');   // room for the wide loads
+        const char* limit = rec.data() + rec.size();
+        const std::uint64_t want = static_cast<std::uint64_t>(Hash{}(k));
+        const char* sep = nullptr;
+        if (hash_bounded<Hash>(rec.data(), k.size(), limit) != want ||
+            hash_scan<Hash>(rec.data(), limit, sep) != want || sep != rec.data() + k.size()) {
+            std::fprintf(stderr, "%s: in-buffer hash differs for \"%s\"\n", hash_name<Hash>(), k.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class Hash>
+static bool run(const Shape& sh, const std::string& buf, const std::vector<std::string_view>& stream, bool verbose) {
+    if (!check<Hash>(sh)) return false;
+    using Table = StationTable<Hash>;
+    Table t(sh.keys.size() * 2);
+    const char* limit = buf.data() + buf.size();
+    const auto t0 = std::chrono::steady_clock::now();
+    for (std::string_view k : stream) t.upsert(k, Table::hash_of(k, limit)).update(1.0);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    const ProbeStats ps = t.probe_stats();
+    std::size_t shared = 0;
+    for (std::size_t n = 2; n < ProbeStats::kBuckets; ++n) shared += ps.home_hist[n];
+    std::printf("%-12s %-8s %10.1f %9.1f %10.3f %6zu %10zu %10zu\n", sh.name, hash_name<Hash>(), ms,
+                static_cast<double>(stream.size()) / ms / 1e3, ps.mean_probe(), ps.max_probe, shared,
+                ps.hash_collisions);
+    if (verbose) ps.report(stdout, hash_name<Hash>());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::size_t rows = 10'000'000;
+    bool verbose = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-v") == 0) verbose = true;
+        else rows = std::strtoull(argv[i], nullptr, 10);
+    }
+
+    std::printf("%-12s %-8s %10s %9s %10s %6s %10s %10s\n", "shape", "hash", "ms", "Mrows/s", "mean_probe",
+                "max", "homes>1", "full_coll");
+    bool ok = true;
+    std::mt19937_64 rng(42);
+    for (const Shape& sh : make_shapes()) {
+        // Records back to back as in the input; the stream points into them
+        std::uniform_int_distribution<std::size_t> pick(0, sh.keys.size() - 1);
+        std::vector<std::size_t> order(rows);
+        std::size_t bytes = 0;
+        for (std::size_t& o : order) bytes += sh.keys[o = pick(rng)].size() + 1;
+        std::string buf;
+        buf.reserve(bytes);
+        for (std::size_t o : order) (buf += sh.keys[o]) += ';';
+        std::vector<std::string_view> stream;
+        stream.reserve(rows);
+        for (std::size_t i = 0, pos = 0; i < rows; pos += sh.keys[order[i++]].size() + 1) {
+            stream.emplace_back(buf.data() + pos, sh.keys[order[i]].size());
+        }
+
+        ok = run<SvHash>(sh, buf, stream, verbose) && ok;
+        ok = run<WordHash>(sh, buf, stream, verbose) && ok;
+        ok = run<Crc32cHash>(sh, buf, stream, verbose) && ok;
+        ok = run<AesHash>(sh, buf, stream, verbose) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// bench_merge.cpp
+// Merge phase on its own: T per-thread tables of K stations each (every table
+// sees most of the stations, the worst case) folded into one, serially with
+// StationTable::merge and sharded with merge_parallel. Uses the PlainSum
+// policy so any change in per-key combine order would show up; the two
+// results must be bit-identical, and merge_parallel must not take more than
+// kMaxSlowdown times the presized serial merge at any thread count (a
+// clustered shard table once made it 100x slower while still correct).
+//
+//   ./bench_merge [keys=1000000] [tables=8]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "station_table.hpp"
+
+using Result = CityResult<PlainSum>;
+using Table = StationTable<SvHash, Result>;
+
+constexpr double kMaxSlowdown = 4.0;
+
+template <class F>
+static double time_ms(F&& f) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+static bool same(const Table& a, Table& b) {
+    if (a.size() != b.size()) return false;
+    bool ok = true;
+    a.for_each([&](std::string_view k, const Result& r) {
+        const Result* o = b.find(k);
+        ok = ok && o && std::memcmp(o, &r, sizeof r) == 0;
+    });
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    const std::size_t n_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    const unsigned n_tables = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 8;
+    unsigned hw = std::thread::hardware_concurrency();
+    if (hw == 0) hw = 1;
+
+    std::mt19937_64 rng(42);
+    std::vector<std::string> keys(n_keys);
+    for (std::size_t i = 0; i < n_keys; ++i) keys[i] = "station-" + std::to_string(rng()) + "-" + std::to_string(i);
+
+    // Each table holds ~90% of the keys, in a different order
+    std::vector<Table> parts;
+    std::uniform_real_distribution<double> val(-10.0, 50.0);
+    for (unsigned t = 0; t < n_tables; ++t) {
+        parts.emplace_back(n_keys * 2);
+        for (std::size_t i = 0; i < n_keys; ++i) {
+            if (rng() % 10 == 0) continue;
+            Result& r = parts.back().upsert(keys[(i * 2654435761u + t) % n_keys]);
+            for (int k = 0; k < 3; ++k) r.update(val(rng));
+        }
+    }
+
+    std::printf("%zu keys x %u tables\n", n_keys, n_tables);
+    Table serial(1 << 12);
+    const double ms_serial = time_ms([&] {
+        for (const Table& t : parts) serial.merge(t);
+    });
+    std::printf("%-18s %10.1f ms\n", "serial merge", ms_serial);
+    Table presized(n_keys * 2);
+    const double ms_presized = time_ms([&] {
+        for (const Table& t : parts) presized.merge(t);
+    });
+    std::printf("%-18s %10.1f ms  (target sized up front)\n", "serial merge", ms_presized);
+
+    bool ok = same(serial, presized), fast = true;
+    // At least 8 threads, so a small machine still exercises several shards
+    for (unsigned th = 1; th <= std::max(hw * 2, 8u) && th <= 64; th *= 2) {
+        Table par(1 << 12);
+        const double ms = time_ms([&] { par.merge_parallel(parts, th); });
+        const bool eq = same(serial, par), slow = ms > kMaxSlowdown * ms_presized;
+        ok = ok && eq;
+        fast = fast && !slow;
+        std::printf("merge_parallel %-3u %10.1f ms  (%.2fx vs presized) %s%s\n", th, ms, ms_presized / ms,
+                    eq ? "" : "MISMATCH", slow ? "TOO SLOW" : "");
+    }
+    if (!ok) {
+        std::fprintf(stderr, "parallel merge differs from serial merge\n");
+        return 1;
+    }
+    if (!fast) {
+        std::fprintf(stderr, "parallel merge is over %.0fx slower than the presized serial merge\n", kMaxSlowdown);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+// bench_parse.cpp
+// Differential check and timing: parse_double / parse_fixed1_swar vs strtod.
+// Every generated string must parse bit-identically to strtod; any mismatch
+// is printed and makes the run fail.
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "parse_value.hpp"
+
+// All strings live in one buffer, '\n'-separated and padded, like the input file.
+struct Corpus {
+    std::string text;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint8_t>  lengths;
+
+    void add(const char* s, std::size_t n) {
+        offsets.push_back(static_cast<std::uint32_t>(text.size()));
+        lengths.push_back(static_cast<std::uint8_t>(n));
+        text.append(s, n);
+        text.push_back('\n');
+    }
+    std::size_t size() const { return offsets.size(); }
+    const char* begin(std::size_t i) const { return text.data() + offsets[i]; }
+    const char* end(std::size_t i) const { return begin(i) + lengths[i]; }
+};
+
+template <class F>
+static double time_ms(F&& f) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+static bool same_bits(double a, double b) {
+    std::uint64_t x, y;
+    std::memcpy(&x, &a, sizeof x);
+    std::memcpy(&y, &b, sizeof y);
+    return x == y;
+}
+
+static double strtod_span(const char* first, const char* last) {
+    char buf[128];
+    std::size_t n = static_cast<std::size_t>(last - first);
+    std::memcpy(buf, first, n);
+    buf[n] = '\0';
+    return std::strtod(buf, nullptr);
+}
+
+// Differential pass: returns the number of mismatches.
+static std::size_t check_full(const Corpus& c, const char* label) {
+    std::size_t bad = 0;
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        double got = 0.0;
+        const char* e = parse_double(c.begin(i), c.end(i), got);
+        double want = strtod_span(c.begin(i), c.end(i));
+        if (e != c.end(i) || !same_bits(got, want)) {
+            if (bad < 10) {
+                std::fprintf(stderr, "[%s] mismatch '%.*s': got %.17g want %.17g\n", label,
+                             static_cast<int>(c.end(i) - c.begin(i)), c.begin(i), got, want);
+            }
+            ++bad;
+        }
+    }
+    return bad;
+}
+
+// Reference for is_fixed1: "-?\d{1,2}\.\d", except -0.0 (and -00.0), whose sign
+// tenths cannot carry.
+enum class Fixed1 { malformed, accept, negative_zero };
+static Fixed1 fixed1_shape(const char* first, const char* last) {
+    const bool neg = first < last && *first == '-';
+    const std::string t(first + neg, last);
+    if (t.size() < 3 || t.size() > 4 || t[t.size() - 2] != '.') return Fixed1::malformed;
+    bool zero = true;
+    for (std::size_t i = 0; i < t.size(); ++i) {
+        if (i == t.size() - 2) continue;
+        if (t[i] < '0' || t[i] > '9') return Fixed1::malformed;
+        zero &= t[i] == '0';
+    }
+    return neg && zero ? Fixed1::negative_zero : Fixed1::accept;
+}
+
+// is_fixed1 must accept exactly the reference shape, the SWAR path must then
+// match strtod, and every well-formed token (refused ones included) must go
+// through parse_double as strtod does.
+static std::size_t check_fixed1(const Corpus& c) {
+    std::size_t bad = 0;
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        const Fixed1 shape = fixed1_shape(c.begin(i), c.end(i));
+        const bool accepted = is_fixed1(c.begin(i), c.end(i));
+        double want = strtod_span(c.begin(i), c.end(i));
+        double got = want;
+        bool ok = accepted == (shape == Fixed1::accept);
+        if (ok && accepted) {
+            const char* e = nullptr;
+            got = parse_fixed1_swar(c.begin(i), &e) / 10.0;
+            ok = e == c.end(i) && same_bits(got, want);
+        }
+        if (ok && shape != Fixed1::malformed) {
+            ok = parse_double(c.begin(i), c.end(i), got) == c.end(i) && same_bits(got, want);
+        }
+        if (!ok) {
+            if (bad < 10) {
+                std::fprintf(stderr, "[fixed1] mismatch '%.*s': %s, got %.17g want %.17g\n",
+                             static_cast<int>(c.end(i) - c.begin(i)), c.begin(i),
+                             accepted ? "accepted" : "refused", got, want);
+            }
+            ++bad;
+        }
+    }
+    return bad;
+}
+
+int main(int argc, char** argv) {
+    const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5'000'000;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> uni(-10.0, 50.0);
+    std::uniform_int_distribution<std::uint64_t> any_bits;
+
+    // Shapes: Python repr (shortest round-trip, what create_test_samples.py writes),
+    // %.17g (always 17 digits), random bit patterns in %.17g, and fixed 1-decimal.
+    Corpus repr, g17, wide, fixed1;
+    char buf[64];
+    for (std::size_t i = 0; i < n; ++i) {
+        double v = uni(rng);
+        auto r = std::to_chars(buf, buf + sizeof buf, v);
+        repr.add(buf, static_cast<std::size_t>(r.ptr - buf));
+
+        int k = std::snprintf(buf, sizeof buf, "%.17g", v);
+        g17.add(buf, static_cast<std::size_t>(k));
+
+        double w;
+        std::uint64_t bits = any_bits(rng);
+        std::memcpy(&w, &bits, sizeof w);
+        if (w != w || w - w != 0.0) w = 0.0;  // skip nan/inf
+        k = std::snprintf(buf, sizeof buf, "%.17g", w);
+        wide.add(buf, static_cast<std::size_t>(k));
+
+        k = std::snprintf(buf, sizeof buf, "%.1f", static_cast<double>(static_cast<int>(rng() % 1999) - 999) / 10.0);
+        fixed1.add(buf, static_cast<std::size_t>(k));
+    }
+    // Tokens the SWAR path must refuse, and near misses it must still take.
+    for (const char* t : {"-0.0", "-00.0", "0.0", "-0.1", "99.9", "-99.9", "1x.5", "1.x", "x1.5",
+                          "+1.5", "-1x.5", "-.5", "1.", ".5", "1:.5", "1/.5", "123.4", "1.5.", "--1.5"}) {
+        fixed1.add(t, std::strlen(t));
+    }
+    fixed1.text.append(8, '\0');  // SWAR reads 8 bytes past the last value's start
+
+    std::size_t bad = check_full(repr, "repr") + check_full(g17, "%.17g") +
+                      check_full(wide, "bits") + check_fixed1(fixed1);
+
+    std::printf("%-16s %10s %12s %12s %9s\n", "corpus", "values", "strtod_ms", "parse_ms", "speedup");
+    auto bench = [&](const Corpus& c, const char* label, bool swar) {
+        double s0 = 0.0, s1 = 0.0;
+        double ms_strtod = time_ms([&] {
+            for (std::size_t i = 0; i < c.size(); ++i) s0 += strtod_span(c.begin(i), c.end(i));
+        });
+        double ms_parse = time_ms([&] {
+            if (swar) {
+                long acc = 0;
+                for (std::size_t i = 0; i < c.size(); ++i) {
+                    const char* e;
+                    acc += parse_fixed1_swar(c.begin(i), &e);
+                }
+                s1 = static_cast<double>(acc);
+            } else {
+                for (std::size_t i = 0; i < c.size(); ++i) {
+                    double v;
+                    parse_double(c.begin(i), c.end(i), v);
+                    s1 += v;
+                }
+            }
+        });
+        std::printf("%-16s %10zu %12.1f %12.1f %8.2fx\n", label, c.size(), ms_strtod, ms_parse,
+                    ms_strtod / ms_parse);
+        if (s0 != s0 || s1 != s1) std::printf("unreachable\n");  // keep the loops alive
+    };
+    bench(repr, "repr", false);
+    bench(g17, "%.17g", false);
+    bench(fixed1, "fixed1", false);
+    bench(fixed1, "fixed1-swar", true);
+
+    if (bad) {
+        std::printf("FAIL: %zu mismatches against strtod\n", bad);
+        return 1;
+    }
+    std::printf("OK: %zu values per corpus bit-identical to strtod\n", n);
+    return 0;
+}
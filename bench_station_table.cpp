@@ -0,0 +1,122 @@
+// bench_station_table.cpp
+// Micro-benchmark: StationTable vs std::unordered_map<std::string, CityResult, SvHash, SvEq>
+// on 100, 10k and 1M distinct keys. Every run performs the same stream of
+// upserts; the keys are pre-built so only the table work is timed. Also
+// counts heap allocations made while filling each table (the flat table
+// interns names in its KeyArena, so only the slot array and the arena's
+// doublings allocate) and times tearing each one down.
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "station_table.hpp"
+
+using StdMap = std::unordered_map<std::string, CityResult<>, SvHash, SvEq>;
+
+// ---------- Allocation counting ----------
+static std::size_t g_allocs = 0;
+
+void* operator new(std::size_t n) {
+    ++g_allocs;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t n, std::align_val_t al) {
+    ++g_allocs;
+    const std::size_t a = static_cast<std::size_t>(al);
+    if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+static std::vector<std::string> make_keys(std::size_t n, std::mt19937_64& rng) {
+    std::uniform_int_distribution<int> len_dist(3, 24);
+    std::uniform_int_distribution<int> ch_dist('a', 'z');
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    StdMap seen;
+    seen.reserve(n);
+    while (keys.size() < n) {
+        std::string k(static_cast<std::size_t>(len_dist(rng)), ' ');
+        for (char& c : k) c = static_cast<char>(ch_dist(rng));
+        if (seen.try_emplace(k).second) keys.push_back(std::move(k));
+    }
+    return keys;
+}
+
+template <class F>
+static double time_ms(F&& f) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+int main() {
+    constexpr std::size_t kOps = 20'000'000;
+    const std::size_t cardinalities[] = {100, 10'000, 1'000'000};
+
+    std::mt19937_64 rng(42);
+    std::printf("%10s %12s %14s %14s %9s %12s %12s %12s %12s\n", "keys", "ops", "unordered_ms", "station_ms",
+                "speedup", "std_allocs", "flat_allocs", "std_free_ms", "flat_free_ms");
+
+    for (std::size_t n : cardinalities) {
+        std::vector<std::string> keys = make_keys(n, rng);
+        std::vector<std::string_view> stream;
+        stream.reserve(kOps);
+        std::uniform_int_distribution<std::size_t> pick(0, n - 1);
+        for (std::size_t i = 0; i < kOps; ++i) stream.emplace_back(keys[pick(rng)]);
+
+        double checksum_a = 0.0, checksum_b = 0.0;
+
+        std::optional<StdMap> std_map;
+        std::size_t allocs_std = g_allocs;
+        double ms_std = time_ms([&] {
+            StdMap& m = std_map.emplace();
+            m.reserve(n);
+            double v = 0.0;
+            for (std::string_view k : stream) {
+                auto it = m.find(k);
+                if (it == m.end()) it = m.emplace(std::string(k), CityResult<>{}).first;
+                it->second.update(v);
+                v = v < 50.0 ? v + 0.5 : -10.0;
+            }
+            for (const auto& kv : m) checksum_a += kv.second.sum();
+        });
+        allocs_std = g_allocs - allocs_std;
+        const double free_std = time_ms([&] { std_map.reset(); });
+
+        std::optional<StationTable<SvHash>> flat;
+        std::size_t allocs_flat = g_allocs;
+        double ms_flat = time_ms([&] {
+            StationTable<SvHash>& t = flat.emplace(n * 2);
+            double v = 0.0;
+            for (std::string_view k : stream) {
+                t.upsert(k).update(v);
+                v = v < 50.0 ? v + 0.5 : -10.0;
+            }
+            t.for_each([&](std::string_view, const CityResult<>& cr) { checksum_b += cr.sum(); });
+        });
+        allocs_flat = g_allocs - allocs_flat;
+        const double free_flat = time_ms([&] { flat.reset(); });
+
+        if (checksum_a != checksum_b) {
+            std::fprintf(stderr, "checksum mismatch at %zu keys\n", n);
+            return 1;
+        }
+        std::printf("%10zu %12zu %14.1f %14.1f %8.2fx %12zu %12zu %12.2f %12.2f\n", n, kOps, ms_std, ms_flat,
+                    ms_std / ms_flat, allocs_std, allocs_flat, free_std, free_flat);
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+// bench_stats.cpp
+// Cost of each extended statistic against the plain CityResult: per-row
+// update time, merge time for per-chunk partials, heap per station, and the
+// error of stddev and p50/p95/p99 against exact values from the sorted rows.
+//
+//   ./bench_stats [rows=50000000] [stations=1000]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "extended_stats.hpp"
+
+template <class F>
+static double time_ms(F&& f) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+struct Exact {
+    double stddev;
+    double q[3];   // p50, p95, p99 (lower)
+};
+
+static std::vector<Exact> exact_stats(const std::vector<double>& values, const std::vector<std::uint16_t>& station,
+                                      std::size_t n_stations) {
+    std::vector<std::vector<double>> per(n_stations);
+    for (std::size_t i = 0; i < values.size(); ++i) per[station[i]].push_back(values[i]);
+    std::vector<Exact> out(n_stations);
+    for (std::size_t s = 0; s < n_stations; ++s) {
+        std::vector<double>& v = per[s];
+        if (v.empty()) continue;
+        double mean = 0.0;
+        for (double x : v) mean += x;
+        mean /= static_cast<double>(v.size());
+        double ss = 0.0;
+        for (double x : v) ss += (x - mean) * (x - mean);
+        out[s].stddev = v.size() > 1 ? std::sqrt(ss / static_cast<double>(v.size() - 1)) : 0.0;
+        std::sort(v.begin(), v.end());
+        const double qs[3] = {0.50, 0.95, 0.99};
+        for (int k = 0; k < 3; ++k) out[s].q[k] = v[static_cast<std::size_t>(qs[k] * static_cast<double>(v.size() - 1))];
+    }
+    return out;
+}
+
+template <class Result>
+static void run(const char* label, const std::vector<double>& values, const std::vector<std::uint16_t>& station,
+                std::size_t n_stations, const std::vector<Exact>& exact, double& plain_ms) {
+    constexpr std::size_t kChunks = 64;
+
+    // Hot path: one update per row into a small table, as the scan kernel does
+    std::vector<Result> table(n_stations);
+    const double ms = time_ms([&] {
+        for (std::size_t i = 0; i < values.size(); ++i) table[station[i]].update(values[i]);
+    });
+    if (plain_ms == 0.0) plain_ms = ms;
+
+    // Per-chunk partials merged into one table, as after a parallel scan
+    std::vector<std::vector<Result>> parts(kChunks, std::vector<Result>(n_stations));
+    const std::size_t per = values.size() / kChunks;
+    for (std::size_t c = 0; c < kChunks; ++c) {
+        for (std::size_t i = c * per; i < (c + 1) * per; ++i) parts[c][station[i]].update(values[i]);
+    }
+    std::vector<Result> merged(n_stations);
+    const double merge_ms = time_ms([&] {
+        for (const auto& part : parts) {
+            for (std::size_t s = 0; s < n_stations; ++s) merged[s].merge(part[s]);
+        }
+    });
+
+    std::size_t heap = 0;
+    double err_sd = 0.0, err_q = 0.0;
+    if constexpr (!std::is_same_v<Result, CityResult<>>) {
+        constexpr std::size_t kExtra = Result::kExtraColumns;
+        for (std::size_t s = 0; s < n_stations; ++s) {
+            const Result& r = table[s];
+            if (!r.extras) continue;
+            heap += sizeof *r.extras;
+            if constexpr (requires { r.extras->sketch.heap_bytes(); }) heap += r.extras->sketch.heap_bytes();
+            double x[kExtra];
+            r.extra_columns(x);
+            std::size_t k = 0;
+            if constexpr ((Result::kStats & kStatVariance) != 0) {
+                err_sd = std::max(err_sd, std::fabs(x[k++] - exact[s].stddev) / exact[s].stddev);
+            }
+            if constexpr ((Result::kStats & kStatQuantiles) != 0) {
+                for (int q = 0; q < 3; ++q, ++k) {
+                    if (exact[s].q[q] != 0.0) err_q = std::max(err_q, std::fabs(x[k] - exact[s].q[q]) / std::fabs(exact[s].q[q]));
+                }
+            }
+        }
+    }
+    std::printf("%-16s %10.1f %9.1f %11.2f %9.1f %10.0f %11.2e %9.3f%%\n", label, ms,
+                static_cast<double>(values.size()) / ms / 1e3, (ms - plain_ms) * 1e6 / static_cast<double>(values.size()),
+                merge_ms, static_cast<double>(heap) / static_cast<double>(n_stations), err_sd, err_q * 100);
+}
+
+int main(int argc, char** argv) {
+    const std::size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50'000'000;
+    const std::size_t n_stations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000;
+    if (n_stations == 0 || n_stations > 65536) {
+        std::fprintf(stderr, "stations must be in [1, 65536]\n");
+        return 2;
+    }
+
+    // 1BRC-like values: a mean per station, normal noise, one decimal
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> station_mean(-20.0, 35.0);
+    std::vector<double> means(n_stations);
+    for (double& m : means) m = station_mean(rng);
+    std::normal_distribution<double> noise(0.0, 10.0);
+    std::vector<double> values(rows);
+    std::vector<std::uint16_t> station(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        station[i] = static_cast<std::uint16_t>(rng() % n_stations);
+        values[i] = std::round(std::clamp(means[station[i]] + noise(rng), -99.9, 99.9) * 10.0) / 10.0;
+    }
+    const std::vector<Exact> exact = exact_stats(values, station, n_stations);
+
+    std::printf("%-16s %10s %9s %11s %9s %10s %11s %10s\n", "stats", "update_ms", "Mrows/s", "+ns/row", "merge_ms",
+                "heap/stn", "sd_rel_err", "q_rel_err");
+    double plain_ms = 0.0;
+    run<CityResult<>>("plain", values, station, n_stations, exact, plain_ms);
+    run<ExtendedResult<kStatVariance>>("+variance", values, station, n_stations, exact, plain_ms);
+    run<ExtendedResult<kStatQuantiles>>("+quantiles", values, station, n_stations, exact, plain_ms);
+    run<ExtendedResult<kStatVariance | kStatQuantiles>>("+both", values, station, n_stations, exact, plain_ms);
+    return 0;
+}
@@ -0,0 +1,152 @@
+// block_reduce.hpp
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// ---------- Block reductions ----------
+// Min, max and sums over a block of one station's values, for the kernels
+// that batch a run of rows before folding it into the station's result. The
+// per-row update is a chain through min, max and the sum; over a block these
+// split into independent vector accumulators that only meet at the end.
+//
+// The widest path is chosen at compile time (the builds use -march=native).
+// Every path gives the same answer as the row-by-row update: min and max are
+// exact, and the integer sums are order-independent.
+namespace block_detail {
+
+#if defined(__AVX512F__)
+inline double hmin(__m512d a) { return _mm512_reduce_min_pd(a); }
+inline double hmax(__m512d a) { return _mm512_reduce_max_pd(a); }
+#elif defined(__AVX2__)
+inline double hmin(__m256d a) {
+    const __m128d m = _mm_min_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+    return _mm_cvtsd_f64(_mm_min_sd(m, _mm_unpackhi_pd(m, m)));
+}
+inline double hmax(__m256d a) {
+    const __m128d m = _mm_max_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+    return _mm_cvtsd_f64(_mm_max_sd(m, _mm_unpackhi_pd(m, m)));
+}
+#endif
+
+}  // namespace block_detail
+
+// Lowers lo / raises hi to the min / max of v[0..n). Written so that a NaN
+// in v is skipped, as the scalar `v < lo ? v : lo` does.
+inline void block_minmax(const double* v, std::size_t n, double& lo, double& hi) noexcept {
+    std::size_t i = 0;
+#if defined(__AVX512F__)
+    __m512d lo0 = _mm512_set1_pd(lo), lo1 = lo0, hi0 = _mm512_set1_pd(hi), hi1 = hi0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512d a = _mm512_loadu_pd(v + i), b = _mm512_loadu_pd(v + i + 8);
+        lo0 = _mm512_min_pd(a, lo0);
+        lo1 = _mm512_min_pd(b, lo1);
+        hi0 = _mm512_max_pd(a, hi0);
+        hi1 = _mm512_max_pd(b, hi1);
+    }
+    for (; i < n; i += 8) {   // masked tail: lanes past n keep the accumulator
+        const std::size_t k = n - i;
+        const __mmask8 m = static_cast<__mmask8>(k >= 8 ? 0xff : (1u << k) - 1);
+        const __m512d a = _mm512_maskz_loadu_pd(m, v + i);
+        lo0 = _mm512_mask_min_pd(lo0, m, a, lo0);
+        hi0 = _mm512_mask_max_pd(hi0, m, a, hi0);
+    }
+    i = n;
+    lo = block_detail::hmin(_mm512_min_pd(lo0, lo1));
+    hi = block_detail::hmax(_mm512_max_pd(hi0, hi1));
+#elif defined(__AVX2__)
+    __m256d lo0 = _mm256_set1_pd(lo), lo1 = lo0, hi0 = _mm256_set1_pd(hi), hi1 = hi0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256d a = _mm256_loadu_pd(v + i), b = _mm256_loadu_pd(v + i + 4);
+        lo0 = _mm256_min_pd(a, lo0);
+        lo1 = _mm256_min_pd(b, lo1);
+        hi0 = _mm256_max_pd(a, hi0);
+        hi1 = _mm256_max_pd(b, hi1);
+    }
+    lo = block_detail::hmin(_mm256_min_pd(lo0, lo1));
+    hi = block_detail::hmax(_mm256_max_pd(hi0, hi1));
+#endif
+    for (; i < n; ++i) {
+        lo = v[i] < lo ? v[i] : lo;
+        hi = v[i] > hi ? v[i] : hi;
+    }
+}
+
+// Sum of u[0..n) in four independent chains.
+inline std::int64_t block_sum(const std::int64_t* u, std::size_t n) noexcept {
+    std::size_t i = 0;
+#if defined(__AVX512F__)
+    __m512i s0 = _mm512_setzero_si512(), s1 = s0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm512_add_epi64(s0, _mm512_loadu_si512(u + i));
+        s1 = _mm512_add_epi64(s1, _mm512_loadu_si512(u + i + 8));
+    }
+    std::int64_t s = _mm512_reduce_add_epi64(_mm512_add_epi64(s0, s1));
+#elif defined(__AVX2__)
+    __m256i s0 = _mm256_setzero_si256(), s1 = s0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_epi64(s0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i)));
+        s1 = _mm256_add_epi64(s1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i + 4)));
+    }
+    alignas(32) std::int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(s0, s1));
+    std::int64_t s = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+    std::int64_t s = 0;
+#endif
+    std::int64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+    for (; i + 4 <= n; i += 4) {
+        t0 += u[i];
+        t1 += u[i + 1];
+        t2 += u[i + 2];
+        t3 += u[i + 3];
+    }
+    for (; i < n; ++i) t0 += u[i];
+    return s + (t0 + t1) + (t2 + t3);
+}
+
+// Sum of v[i] * scale rounded half away from zero and truncated to int64,
+// each term exactly as FixedSum::add rounds it. False, leaving out alone,
+// when some v[i] * scale is not finite or not below max_term in magnitude;
+// n * max_term must fit an int64.
+inline bool block_round_sum(const double* v, std::size_t n, double scale, double max_term,
+                            std::int64_t& out) noexcept {
+    std::size_t i = 0;
+    std::int64_t s = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    const __m512d k = _mm512_set1_pd(scale), half = _mm512_set1_pd(0.5), sign = _mm512_set1_pd(-0.0);
+    const __m512d lim = _mm512_set1_pd(max_term);
+    __m512i s0 = _mm512_setzero_si512(), s1 = s0;
+    __mmask8 ok = 0xff;
+    auto term = [&](__m512d x) {
+        x = _mm512_mul_pd(x, k);
+        ok &= _mm512_cmp_pd_mask(_mm512_andnot_pd(sign, x), lim, _CMP_LT_OQ);
+        return _mm512_cvttpd_epi64(_mm512_add_pd(x, _mm512_or_pd(half, _mm512_and_pd(x, sign))));
+    };
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm512_add_epi64(s0, term(_mm512_loadu_pd(v + i)));
+        s1 = _mm512_add_epi64(s1, term(_mm512_loadu_pd(v + i + 8)));
+    }
+    if (ok != 0xff) return false;
+    s = _mm512_reduce_add_epi64(_mm512_add_epi64(s0, s1));
+#endif
+    std::int64_t t0 = 0, t1 = 0;
+    bool ok_tail = true;
+    auto one = [&](double d) {
+        const double x = d * scale;
+        ok_tail &= std::fabs(x) < max_term;
+        return ok_tail ? static_cast<std::int64_t>(x + std::copysign(0.5, x)) : 0;
+    };
+    for (; i + 2 <= n; i += 2) {
+        t0 += one(v[i]);
+        t1 += one(v[i + 1]);
+    }
+    for (; i < n; ++i) t0 += one(v[i]);
+    if (!ok_tail) return false;
+    out = s + t0 + t1;
+    return true;
+}
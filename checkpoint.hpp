@@ -0,0 +1,156 @@
+// checkpoint.hpp
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <sys/stat.h>
+
+// ---------- Incremental checkpoint ----------
+// Binary snapshot of an aggregated station table plus where the scan stopped:
+//
+//   header   magic "BRCCKPT2", accumulator tag, sizeof(Result),
+//            input identity (dev, inode, size, mtime), byte offset of the
+//            first unprocessed line, FNV-1a of the 64 bytes before it,
+//            station count
+//   records  u32 name length, name bytes, raw Result bytes (or what
+//            Result::save writes, for results with heap state)
+//
+// A later run resumes at `offset` when dev/inode match, the file has not
+// shrunk and the bytes before `offset` still hash to `tail_fp`; otherwise it
+// rescans from zero. Results are only comparable under the same accumulator
+// policy, so the tag and size must match too.
+
+struct FileIdentity {
+    std::uint64_t dev = 0;
+    std::uint64_t ino = 0;
+    std::uint64_t size = 0;
+    std::uint64_t mtime_ns = 0;
+};
+
+inline bool stat_identity(const char* path, FileIdentity& id) {
+    struct stat st;
+    if (::stat(path, &st) != 0) return false;
+    id.dev = static_cast<std::uint64_t>(st.st_dev);
+    id.ino = static_cast<std::uint64_t>(st.st_ino);
+    id.size = static_cast<std::uint64_t>(st.st_size);
+#if defined(__APPLE__)
+    id.mtime_ns = static_cast<std::uint64_t>(st.st_mtimespec.tv_sec) * 1000000000ull + st.st_mtimespec.tv_nsec;
+#else
+    id.mtime_ns = static_cast<std::uint64_t>(st.st_mtim.tv_sec) * 1000000000ull + st.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+// Fingerprint of the (up to) 64 bytes that end at `end`.
+inline std::uint64_t tail_fingerprint(const char* end, std::size_t avail) {
+    std::size_t n = avail < 64 ? avail : 64;
+    std::uint64_t h = 1469598103934665603ull;
+    for (const char* p = end - n; p < end; ++p) {
+        h ^= static_cast<unsigned char>(*p);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Results tag themselves when they carry more than the accumulator
+// (ExtendedResult), so a checkpoint from another build is rejected.
+template <class Result>
+constexpr std::uint32_t result_tag() {
+    if constexpr (requires { Result::kTag; }) return Result::kTag;
+    else return Result::accum_type::kTag;
+}
+
+template <class Result>
+concept SelfSerializing = requires(const Result& c, Result& r, FILE* fp) {
+    { c.save(fp) } -> std::same_as<bool>;
+    { r.load(fp) } -> std::same_as<bool>;
+};
+
+struct CheckpointHeader {
+    char          magic[8];
+    std::uint32_t accum_tag;
+    std::uint32_t result_size;
+    FileIdentity  id;
+    std::uint64_t offset;
+    std::uint64_t tail_fp;
+    std::uint64_t stations;
+};
+
+// Writes to path + ".tmp" and renames, so a crash never leaves a torn file.
+template <class Table>
+bool save_checkpoint(const char* path, const FileIdentity& id, std::uint64_t offset,
+                     std::uint64_t tail_fp, const Table& table) {
+    using Result = typename Table::result_type;
+    static_assert(std::is_trivially_copyable_v<Result> || SelfSerializing<Result>,
+                  "Result is stored as raw bytes unless it has save/load");
+
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* fp = std::fopen(tmp.c_str(), "wb");
+    if (!fp) { std::perror("fopen"); return false; }
+
+    CheckpointHeader h{};
+    std::memcpy(h.magic, "BRCCKPT2", 8);
+    h.accum_tag = result_tag<Result>();
+    h.result_size = sizeof(Result);
+    h.id = id;
+    h.offset = offset;
+    h.tail_fp = tail_fp;
+    h.stations = table.size();
+    bool ok = std::fwrite(&h, sizeof h, 1, fp) == 1;
+
+    table.for_each([&](std::string_view name, const Result& r) {
+        std::uint32_t len = static_cast<std::uint32_t>(name.size());
+        ok = ok && std::fwrite(&len, sizeof len, 1, fp) == 1;
+        ok = ok && std::fwrite(name.data(), 1, len, fp) == len;
+        if constexpr (SelfSerializing<Result>) ok = ok && r.save(fp);
+        else ok = ok && std::fwrite(&r, sizeof r, 1, fp) == 1;
+    });
+
+    ok = (std::fclose(fp) == 0) && ok;
+    if (!ok || std::rename(tmp.c_str(), path) != 0) {
+        std::perror("checkpoint");
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Loads into an empty table. Returns false (table untouched or cleared by the
+// caller) when the file is missing, truncated or from another accumulator.
+template <class Table>
+bool load_checkpoint(const char* path, CheckpointHeader& h, Table& table) {
+    using Result = typename Table::result_type;
+
+    FILE* fp = std::fopen(path, "rb");
+    if (!fp) return false;
+
+    bool ok = std::fread(&h, sizeof h, 1, fp) == 1 &&
+              std::memcmp(h.magic, "BRCCKPT2", 8) == 0 &&
+              h.accum_tag == result_tag<Result>() &&
+              h.result_size == sizeof(Result);
+
+    // Records come in the writer's slot order; size the table up front so
+    // they do not pile up before a grow (capped against a corrupt count)
+    if (ok) table.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(h.stations, 1u << 24)));
+    std::string name;
+    for (std::uint64_t i = 0; ok && i < h.stations; ++i) {
+        std::uint32_t len = 0;
+        Result r;
+        ok = std::fread(&len, sizeof len, 1, fp) == 1 && len < (1u << 20);
+        if (!ok) break;
+        name.resize(len);
+        ok = std::fread(name.data(), 1, len, fp) == len;
+        if constexpr (SelfSerializing<Result>) ok = ok && r.load(fp);
+        else ok = ok && std::fread(&r, sizeof r, 1, fp) == 1;
+        if (ok) table.upsert(name) = std::move(r);
+    }
+    std::fclose(fp);
+    return ok;
+}
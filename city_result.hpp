@@ -0,0 +1,100 @@
+// city_result.hpp
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <string_view>
+
+#include "accum.hpp"
+#include "block_reduce.hpp"
+
+// Sum policy used when CityResult<> is named without one. Override at build
+// time, e.g. -DBRC_ACCUM=PlainSum, -DBRC_ACCUM=NeumaierSum or, for input
+// known to have at most 6 decimals, -DBRC_ACCUM=FixedSum<6>.
+#ifndef BRC_ACCUM
+#define BRC_ACCUM MixedSum<2>
+#endif
+using DefaultAccum = BRC_ACCUM;
+
+// ---------- City stats ----------
+template <class Accum = DefaultAccum>
+struct CityResult {
+    using accum_type = Accum;
+
+    double min  =  std::numeric_limits<double>::infinity();
+    double max  = -std::numeric_limits<double>::infinity();
+    Accum  acc;     // the sum and the value count
+
+    // Fold one measurement in (the +/-inf defaults make the first sample work
+    // too). Selects rather than branches: shuffled input would mispredict an
+    // `if`, and minsd/maxsd do not.
+    void update(double v) noexcept {
+        min = v < min ? v : min;
+        max = v > max ? v : max;
+        acc.add(v);
+    }
+
+    // Same as update(v) for a value parsed as u * 10^-N; fixed-point
+    // accumulators take u directly instead of re-scaling v.
+    template <int N>
+    void update_units(double v, std::int64_t u) noexcept {
+        min = v < min ? v : min;
+        max = v > max ? v : max;
+        if constexpr (requires { acc.template add_units<N>(u); }) acc.template add_units<N>(u);
+        else acc.add(v);
+    }
+
+    // Same as update() for each of v[0..n), reduced as a block (see
+    // block_reduce.hpp) when the accumulator has a block add.
+    void update_block(const double* v, std::size_t n) noexcept {
+        if constexpr (requires { acc.add_block(v, n); }) {
+            block_minmax(v, n, min, max);
+            acc.add_block(v, n);
+        } else {
+            for (std::size_t i = 0; i < n; ++i) update(v[i]);
+        }
+    }
+    // Same as update_units<N>() for each (v[i], u[i]).
+    template <int N>
+    void update_units_block(const double* v, const std::int64_t* u, std::size_t n) noexcept {
+        if constexpr (requires { acc.template add_units_block<N>(u, n); }) {
+            block_minmax(v, n, min, max);
+            acc.template add_units_block<N>(u, n);
+        } else {
+            for (std::size_t i = 0; i < n; ++i) update_units<N>(v[i], u[i]);
+        }
+    }
+
+    // Combine partial results from another table
+    void merge(const CityResult& o) noexcept {
+        if (o.min < min) min = o.min;
+        if (o.max > max) max = o.max;
+        acc.merge(o.acc);
+    }
+
+    int count() const noexcept { return acc.count(); }
+    double sum() const noexcept { return acc.total(); }
+    double mean() const noexcept {
+        return count() ? sum() / static_cast<double>(count()) : 0.0;
+    }
+};
+
+// ---------- Transparent hash/equal for heterogenous lookup ----------
+struct SvHash {
+    using is_transparent = void;  // enables heterogenous lookup
+    std::size_t operator()(std::string_view s) const noexcept {
+        // FNV-1a 64-bit
+        std::uint64_t h = 1469598103934665603ull;
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return static_cast<std::size_t>(h);
+    }
+};
+struct SvEq {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const noexcept {
+        return a == b;
+    }
+};
@@ -0,0 +1,293 @@
+// columnar.hpp
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "city_result.hpp"
+
+// ---------- Columnar snapshot format ----------
+// A parsed copy of a measurement file, so repeat queries scan two dense
+// columns instead of re-parsing text:
+//
+//   ColumnarHeader
+//   dictionary    u32 offsets[stations + 1], then the concatenated names
+//                 (ids follow name order)
+//   ids column    rows x u8/u16/u32, the narrowest that fits `stations`
+//   values column rows x f64, as parsed from the text
+//   block entries per block, one BlockEntry per station present in it
+//   block index   blocks x BlockIndex
+//
+// Each block of kBlockRows rows carries the CityResult of every station it
+// contains, so a whole-file query merges the block entries and never touches
+// the columns. Results are stored raw, so the accumulator tag must match.
+
+constexpr std::uint32_t kBlockRows = 1 << 16;
+
+struct ColumnarHeader {
+    char          magic[8];        // "BRCCOL02"
+    std::uint32_t accum_tag;
+    std::uint32_t result_size;
+    std::uint64_t rows;
+    std::uint32_t stations;
+    std::uint32_t id_width;        // bytes per id: 1, 2 or 4
+    std::uint32_t block_rows;
+    std::uint32_t reserved;
+    std::uint64_t blocks;
+    std::uint64_t dict_offset;
+    std::uint64_t ids_offset;
+    std::uint64_t values_offset;
+    std::uint64_t entries_offset;
+    std::uint64_t index_offset;
+};
+
+struct BlockIndex {
+    std::uint64_t entries;         // file offset of the first BlockEntry
+    std::uint32_t n_entries;
+    std::uint32_t rows;
+};
+
+// The Result is stored as its bytes, so the entry is a plain record that
+// value-initializes to zeros (padding included) and is read back by copy.
+template <class Result>
+struct BlockEntry {
+    static_assert(std::is_trivially_copyable_v<Result>, "block stats are stored by memcpy");
+
+    std::uint32_t id;
+    std::uint32_t reserved;
+    alignas(Result) unsigned char stats[sizeof(Result)];
+
+    Result load() const {
+        Result r;
+        std::memcpy(&r, stats, sizeof r);
+        return r;
+    }
+};
+
+inline std::uint32_t id_width_for(std::size_t stations) {
+    return stations <= 0x100 ? 1 : stations <= 0x10000 ? 2 : 4;
+}
+
+// ---------- Writer ----------
+// Sequential appends to one region of the output file through pwrite, so the
+// id, value and entry columns can be streamed at the same time.
+class FileCursor {
+public:
+    FileCursor() = default;
+    FileCursor(int fd, std::uint64_t off) { start(fd, off); }
+
+    void start(int fd, std::uint64_t off) {
+        fd_ = fd;
+        off_ = off;
+        buf_.reserve(kBuf);
+    }
+
+    void put(const void* p, std::size_t n) {
+        if (buf_.size() + n > kBuf) flush();
+        const char* c = static_cast<const char*>(p);
+        buf_.insert(buf_.end(), c, c + n);
+    }
+
+    bool flush() {
+        std::size_t done = 0;
+        while (done < buf_.size()) {
+            ssize_t w = ::pwrite(fd_, buf_.data() + done, buf_.size() - done, static_cast<off_t>(off_));
+            if (w <= 0) { ok_ = false; break; }
+            done += static_cast<std::size_t>(w);
+            off_ += static_cast<std::uint64_t>(w);
+        }
+        buf_.clear();
+        return ok_;
+    }
+
+    std::uint64_t offset() const { return off_ + buf_.size(); }
+    bool ok() const { return ok_; }
+
+private:
+    static constexpr std::size_t kBuf = 1 << 20;
+    int               fd_ = -1;
+    std::uint64_t     off_ = 0;
+    std::vector<char> buf_;
+    bool              ok_ = true;
+};
+
+template <class Result = CityResult<>>
+class ColumnarWriter {
+public:
+    // `names` must be sorted; `rows` is the exact number of add() calls to come.
+    bool open(const char* path, const std::vector<std::string_view>& names, std::uint64_t rows) {
+        fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) { std::perror("open"); return false; }
+
+        std::memset(&h_, 0, sizeof h_);
+        std::memcpy(h_.magic, "BRCCOL02", 8);
+        h_.accum_tag = Result::accum_type::kTag;
+        h_.result_size = sizeof(Result);
+        h_.rows = rows;
+        h_.stations = static_cast<std::uint32_t>(names.size());
+        h_.id_width = id_width_for(names.size());
+        h_.block_rows = kBlockRows;
+        h_.blocks = (rows + kBlockRows - 1) / kBlockRows;
+
+        h_.dict_offset = sizeof(ColumnarHeader);
+        FileCursor dict(fd_, h_.dict_offset);
+        std::uint32_t off = 0;
+        for (std::string_view n : names) { dict.put(&off, sizeof off); off += static_cast<std::uint32_t>(n.size()); }
+        dict.put(&off, sizeof off);
+        for (std::string_view n : names) dict.put(n.data(), n.size());
+        if (!dict.flush()) return false;
+
+        h_.ids_offset = align8(dict.offset());
+        h_.values_offset = align8(h_.ids_offset + rows * h_.id_width);
+        h_.entries_offset = h_.values_offset + rows * sizeof(double);
+        ids_.start(fd_, h_.ids_offset);
+        values_.start(fd_, h_.values_offset);
+        entries_.start(fd_, h_.entries_offset);
+
+        block_stats_.assign(names.size(), Result{});
+        return true;
+    }
+
+    void add(std::uint32_t id, double v) {
+        switch (h_.id_width) {
+            case 1: { std::uint8_t  x = static_cast<std::uint8_t>(id);  ids_.put(&x, 1); break; }
+            case 2: { std::uint16_t x = static_cast<std::uint16_t>(id); ids_.put(&x, 2); break; }
+            default: ids_.put(&id, 4); break;
+        }
+        values_.put(&v, sizeof v);
+
+        Result& r = block_stats_[id];
+        if (r.count() == 0) touched_.push_back(id);
+        r.update(v);
+        if (++block_fill_ == kBlockRows) end_block();
+    }
+
+    bool close() {
+        if (block_fill_) end_block();
+        bool ok = ids_.flush() && values_.flush() && entries_.flush();
+
+        h_.index_offset = entries_.offset();
+        FileCursor index(fd_, h_.index_offset);
+        for (const BlockIndex& b : index_) index.put(&b, sizeof b);
+        ok = index.flush() && ok && index_.size() == h_.blocks;
+
+        ok = ok && ::pwrite(fd_, &h_, sizeof h_, 0) == static_cast<ssize_t>(sizeof h_);
+        ok = (::close(fd_) == 0) && ok;
+        fd_ = -1;
+        if (!ok) std::fprintf(stderr, "columnar: write failed\n");
+        return ok;
+    }
+
+private:
+    static std::uint64_t align8(std::uint64_t x) { return (x + 7) & ~std::uint64_t{7}; }
+
+    void end_block() {
+        std::sort(touched_.begin(), touched_.end());
+        BlockIndex b{entries_.offset(), static_cast<std::uint32_t>(touched_.size()), block_fill_};
+        for (std::uint32_t id : touched_) {
+            BlockEntry<Result> e{};
+            e.id = id;
+            std::memcpy(e.stats, &block_stats_[id], sizeof e.stats);
+            entries_.put(&e, sizeof e);
+            block_stats_[id] = Result{};
+        }
+        index_.push_back(b);
+        touched_.clear();
+        block_fill_ = 0;
+    }
+
+    int                        fd_ = -1;
+    ColumnarHeader             h_;
+    FileCursor                 ids_, values_, entries_;
+    std::vector<Result>        block_stats_;
+    std::vector<std::uint32_t> touched_;
+    std::vector<BlockIndex>    index_;
+    std::uint32_t              block_fill_ = 0;
+};
+
+// ---------- Reader ----------
+template <class Result = CityResult<>>
+class ColumnarFile {
+public:
+    bool open(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) { std::perror("open"); return false; }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) { std::perror("fstat"); ::close(fd); return false; }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ < sizeof(ColumnarHeader)) { ::close(fd); return bad("too small"); }
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) { std::perror("mmap"); size_ = 0; return false; }
+        base_ = static_cast<const char*>(p);
+        std::memcpy(&h_, base_, sizeof h_);
+
+        if (std::memcmp(h_.magic, "BRCCOL02", 8) != 0) return bad("bad magic");
+        if (h_.accum_tag != Result::accum_type::kTag || h_.result_size != sizeof(Result))
+            return bad("written with a different accumulator policy");
+        if (h_.index_offset + h_.blocks * sizeof(BlockIndex) > size_) return bad("truncated");
+        return true;
+    }
+
+    ~ColumnarFile() {
+        if (base_) ::munmap(const_cast<char*>(base_), size_);
+    }
+
+    const ColumnarHeader& header() const { return h_; }
+
+    std::string_view name(std::uint32_t id) const {
+        const std::uint32_t* offs = reinterpret_cast<const std::uint32_t*>(base_ + h_.dict_offset);
+        const char* blob = base_ + h_.dict_offset + (h_.stations + 1) * sizeof(std::uint32_t);
+        return {blob + offs[id], offs[id + 1] - offs[id]};
+    }
+
+    template <class Id>
+    const Id* ids() const { return reinterpret_cast<const Id*>(base_ + h_.ids_offset); }
+    const double* values() const { return reinterpret_cast<const double*>(base_ + h_.values_offset); }
+
+    // Whole-file aggregate from the block entries alone.
+    std::vector<Result> aggregate_from_blocks() const {
+        std::vector<Result> out(h_.stations);
+        const BlockIndex* idx = reinterpret_cast<const BlockIndex*>(base_ + h_.index_offset);
+        for (std::uint64_t b = 0; b < h_.blocks; ++b) {
+            const BlockEntry<Result>* e = reinterpret_cast<const BlockEntry<Result>*>(base_ + idx[b].entries);
+            for (std::uint32_t i = 0; i < idx[b].n_entries; ++i) out[e[i].id].merge(e[i].load());
+        }
+        return out;
+    }
+
+    // Column scan of rows [begin, end) into a dense per-id table.
+    void scan_rows(std::uint64_t begin, std::uint64_t end, std::vector<Result>& out) const {
+        switch (h_.id_width) {
+            case 1:  scan_rows_as<std::uint8_t>(begin, end, out); break;
+            case 2:  scan_rows_as<std::uint16_t>(begin, end, out); break;
+            default: scan_rows_as<std::uint32_t>(begin, end, out); break;
+        }
+    }
+
+private:
+    template <class Id>
+    void scan_rows_as(std::uint64_t begin, std::uint64_t end, std::vector<Result>& out) const {
+        const Id* id = ids<Id>();
+        const double* v = values();
+        for (std::uint64_t r = begin; r < end; ++r) out[id[r]].update(v[r]);
+    }
+
+    bool bad(const char* why) {
+        std::fprintf(stderr, "columnar: %s\n", why);
+        return false;
+    }
+
+    const char*    base_ = nullptr;
+    std::size_t    size_ = 0;
+    ColumnarHeader h_{};
+};
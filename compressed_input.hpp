@@ -0,0 +1,622 @@
+// compressed_input.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#endif
+
+// ---------- Compressed input ----------
+// gzip and zstd input is recognised by its magic bytes and decoded in memory
+// straight into the parser, never to a file. The decoders are loaded at run
+// time with dlopen (libz.so.1, libzstd.so.1) against the libraries' stable
+// ABI, so the build needs neither the headers nor link flags, in the same
+// spirit as the raw-syscall io_uring backend; without the library, that
+// format reports an error and plain input is unaffected.
+//
+// When a file is a sequence of independent frames whose decoded sizes are
+// known up front, the frames are decoded in parallel: zstd frames with a
+// content size (pzstd output, the seekable format, whose seek table is a
+// skippable frame and is skipped), and BGZF gzip members (bgzip output, whose
+// member sizes are in the header). Anything else is decoded by one streaming
+// decoder thread, 4 MiB at a time, while the parser threads consume the
+// chunks it has finished.
+
+enum class Codec { None, Gzip, Zstd };
+
+inline const char* codec_name(Codec c) {
+    switch (c) {
+        case Codec::Gzip: return "gzip";
+        case Codec::Zstd: return "zstd";
+        default:          return "none";
+    }
+}
+
+inline Codec detect_codec(const char* p, std::size_t n) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    if (n >= 2 && u[0] == 0x1f && u[1] == 0x8b) return Codec::Gzip;
+    if (n >= 4 && u[0] == 0x28 && u[1] == 0xb5 && u[2] == 0x2f && u[3] == 0xfd) return Codec::Zstd;
+    if (n >= 4 && (u[0] & 0xf0) == 0x50 && u[1] == 0x2a && u[2] == 0x4d && u[3] == 0x18) return Codec::Zstd;   // skippable frame first
+    return Codec::None;
+}
+
+// The codec of the file at path, from its first bytes.
+inline Codec sniff_codec(const char* path) {
+    char head[4];
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return Codec::None;
+    const ssize_t n = ::pread(fd, head, sizeof head, 0);
+    ::close(fd);
+    return n > 0 ? detect_codec(head, static_cast<std::size_t>(n)) : Codec::None;
+}
+
+namespace codec_detail {
+
+inline void* load(const char* const* names) {
+    for (; *names; ++names) {
+        if (void* h = ::dlopen(*names, RTLD_NOW | RTLD_LOCAL)) return h;
+    }
+    return nullptr;
+}
+
+template <class F>
+inline bool bind(void* lib, const char* name, F& f) {
+    f = lib ? reinterpret_cast<F>(::dlsym(lib, name)) : nullptr;
+    return f != nullptr;
+}
+
+// zlib's z_stream, field for field (checked against zlib.h when present).
+struct ZStream {
+    const unsigned char* next_in = nullptr;
+    unsigned int         avail_in = 0;
+    unsigned long        total_in = 0;
+    unsigned char*       next_out = nullptr;
+    unsigned int         avail_out = 0;
+    unsigned long        total_out = 0;
+    const char*          msg = nullptr;
+    void*                state = nullptr;
+    void*                zalloc = nullptr;
+    void*                zfree = nullptr;
+    void*                opaque = nullptr;
+    int                  data_type = 0;
+    unsigned long        adler = 0;
+    unsigned long        reserved = 0;
+};
+#if __has_include(<zlib.h>)
+static_assert(sizeof(ZStream) == sizeof(z_stream), "ZStream must mirror z_stream");
+#endif
+
+struct Zlib {
+    static constexpr int kOk = 0, kStreamEnd = 1, kBufError = -5;
+    static constexpr int kGzipWindow = 15 + 16;   // gzip wrapper only
+
+    int (*inflateInit2_)(ZStream*, int, const char*, int) = nullptr;
+    int (*inflate)(ZStream*, int) = nullptr;
+    int (*inflateReset)(ZStream*) = nullptr;
+    int (*inflateEnd)(ZStream*) = nullptr;
+    bool ok = false;
+
+    static const Zlib& get() {
+        static const Zlib z = [] {
+            static const char* const kNames[] = {"libz.so.1", "libz.so", "libz.dylib", nullptr};
+            Zlib r;
+            void* lib = load(kNames);
+            r.ok = bind(lib, "inflateInit2_", r.inflateInit2_) && bind(lib, "inflate", r.inflate) &&
+                   bind(lib, "inflateReset", r.inflateReset) && bind(lib, "inflateEnd", r.inflateEnd);
+            return r;
+        }();
+        return z;
+    }
+
+    bool init(ZStream& s) const {
+        s = ZStream{};
+        return inflateInit2_(&s, kGzipWindow, "1.2.11", static_cast<int>(sizeof(ZStream))) == kOk;
+    }
+};
+
+struct ZstdIn {
+    const void* src;
+    std::size_t size;
+    std::size_t pos;
+};
+struct ZstdOut {
+    void*       dst;
+    std::size_t size;
+    std::size_t pos;
+};
+
+struct Zstd {
+    static constexpr unsigned long long kSizeUnknown = ~0ull, kSizeError = ~0ull - 1;
+
+    void* (*createDCtx)() = nullptr;
+    std::size_t (*freeDCtx)(void*) = nullptr;
+    std::size_t (*decompressStream)(void*, ZstdOut*, ZstdIn*) = nullptr;
+    std::size_t (*decompressDCtx)(void*, void*, std::size_t, const void*, std::size_t) = nullptr;
+    unsigned (*isError)(std::size_t) = nullptr;
+    const char* (*getErrorName)(std::size_t) = nullptr;
+    unsigned long long (*getFrameContentSize)(const void*, std::size_t) = nullptr;
+    std::size_t (*findFrameCompressedSize)(const void*, std::size_t) = nullptr;
+    bool ok = false;
+
+    static const Zstd& get() {
+        static const Zstd z = [] {
+            static const char* const kNames[] = {"libzstd.so.1", "libzstd.so", "libzstd.dylib", nullptr};
+            Zstd r;
+            void* lib = load(kNames);
+            r.ok = bind(lib, "ZSTD_createDCtx", r.createDCtx) && bind(lib, "ZSTD_freeDCtx", r.freeDCtx) &&
+                   bind(lib, "ZSTD_decompressStream", r.decompressStream) &&
+                   bind(lib, "ZSTD_decompressDCtx", r.decompressDCtx) && bind(lib, "ZSTD_isError", r.isError) &&
+                   bind(lib, "ZSTD_getErrorName", r.getErrorName) &&
+                   bind(lib, "ZSTD_getFrameContentSize", r.getFrameContentSize) &&
+                   bind(lib, "ZSTD_findFrameCompressedSize", r.findFrameCompressedSize);
+            return r;
+        }();
+        return z;
+    }
+};
+
+inline bool available(Codec c) {
+    if (c == Codec::Gzip && !Zlib::get().ok) {
+        std::fprintf(stderr, "gzip input needs libz.so.1, which could not be loaded\n");
+        return false;
+    }
+    if (c == Codec::Zstd && !Zstd::get().ok) {
+        std::fprintf(stderr, "zstd input needs libzstd.so.1, which could not be loaded\n");
+        return false;
+    }
+    return true;
+}
+
+inline bool gzip_at(const char* p, std::size_t n) {
+    return n >= 2 && static_cast<unsigned char>(p[0]) == 0x1f && static_cast<unsigned char>(p[1]) == 0x8b;
+}
+
+// ---------- Streaming decoder ----------
+// One gzip or zstd stream, any number of members/frames, decoded into
+// caller buffers a piece at a time.
+class StreamDecoder {
+public:
+    StreamDecoder(Codec c, const char* data, std::size_t size) : codec_(c), in_(data), end_(data + size) {
+        if (c == Codec::Gzip) ok_ = Zlib::get().init(z_);
+        else ok_ = (zd_ = Zstd::get().createDCtx()) != nullptr;
+        if (!ok_) std::fprintf(stderr, "%s: decoder setup failed\n", codec_name(c));
+    }
+    StreamDecoder(const StreamDecoder&) = delete;
+    StreamDecoder& operator=(const StreamDecoder&) = delete;
+    ~StreamDecoder() {
+        if (codec_ == Codec::Gzip && ok_) Zlib::get().inflateEnd(&z_);
+        if (zd_) Zstd::get().freeDCtx(zd_);
+    }
+
+    // Fills up to cap bytes of out; sets done at the end of the input.
+    // Returns the bytes written, or -1 on corrupt input.
+    std::ptrdiff_t read(char* out, std::size_t cap, bool& done) {
+        done = false;
+        if (!ok_) return -1;
+        return codec_ == Codec::Gzip ? read_gzip(out, cap, done) : read_zstd(out, cap, done);
+    }
+
+    std::size_t consumed(const char* data) const { return static_cast<std::size_t>(in_ - data); }
+
+private:
+    std::ptrdiff_t read_gzip(char* out, std::size_t cap, bool& done) {
+        const Zlib& zl = Zlib::get();
+        std::size_t got = 0;
+        while (got < cap) {
+            if (in_ == end_) {
+                if (!member_done_) {
+                    std::fprintf(stderr, "gzip: truncated input\n");
+                    return -1;
+                }
+                done = true;
+                break;
+            }
+            const std::size_t avail = std::min<std::size_t>(static_cast<std::size_t>(end_ - in_), 1u << 30);
+            z_.next_in = reinterpret_cast<const unsigned char*>(in_);
+            z_.avail_in = static_cast<unsigned>(avail);
+            z_.next_out = reinterpret_cast<unsigned char*>(out + got);
+            z_.avail_out = static_cast<unsigned>(std::min<std::size_t>(cap - got, 1u << 30));
+            const unsigned out_before = z_.avail_out;
+            const int rc = zl.inflate(&z_, 0);
+            in_ += avail - z_.avail_in;
+            got += out_before - z_.avail_out;
+            member_done_ = rc == Zlib::kStreamEnd;
+            if (rc == Zlib::kStreamEnd) {
+                // Another member may follow; anything else after the last one is ignored, as gzip -d does
+                if (!gzip_at(in_, static_cast<std::size_t>(end_ - in_))) in_ = end_;
+                else if (zl.inflateReset(&z_) != Zlib::kOk) return -1;
+            } else if (rc != Zlib::kOk && !(rc == Zlib::kBufError && z_.avail_out == 0)) {
+                std::fprintf(stderr, "gzip: corrupt input%s%s\n", z_.msg ? ": " : "", z_.msg ? z_.msg : "");
+                return -1;
+            }
+        }
+        return static_cast<std::ptrdiff_t>(got);
+    }
+
+    std::ptrdiff_t read_zstd(char* out, std::size_t cap, bool& done) {
+        const Zstd& zs = Zstd::get();
+        ZstdOut o{out, cap, 0};
+        while (o.pos < cap) {
+            if (in_ == end_) {
+                if (!frame_done_) {
+                    std::fprintf(stderr, "zstd: truncated input\n");
+                    return -1;
+                }
+                done = true;
+                break;
+            }
+            ZstdIn i{in_, static_cast<std::size_t>(end_ - in_), 0};
+            const std::size_t rc = zs.decompressStream(zd_, &o, &i);
+            in_ += i.pos;
+            if (zs.isError(rc)) {
+                std::fprintf(stderr, "zstd: %s\n", zs.getErrorName(rc));
+                return -1;
+            }
+            frame_done_ = rc == 0;
+        }
+        return static_cast<std::ptrdiff_t>(o.pos);
+    }
+
+    Codec       codec_;
+    const char* in_;
+    const char* end_;
+    bool        ok_ = false;
+    ZStream     z_;
+    void*       zd_ = nullptr;
+    bool        frame_done_ = true;    // zstd: no frame half-decoded
+    bool        member_done_ = true;   // gzip: no member half-decoded
+};
+
+// ---------- Independent frames ----------
+struct Frame {
+    std::size_t off = 0;       // compressed bytes [off, off + len)
+    std::size_t len = 0;
+    std::size_t decoded = 0;   // exact decoded size
+};
+
+// Splits data into frames that decode independently to a known size; false
+// when the file is not laid out that way (then it is decoded as one stream).
+inline bool split_frames(Codec c, const char* data, std::size_t size, std::vector<Frame>& out) {
+    out.clear();
+    if (c == Codec::Zstd) {
+        const Zstd& zs = Zstd::get();
+        for (std::size_t off = 0; off < size;) {
+            const std::size_t len = zs.findFrameCompressedSize(data + off, size - off);
+            if (zs.isError(len) || len == 0) return false;
+            const unsigned char* u = reinterpret_cast<const unsigned char*>(data + off);
+            const bool skippable = (u[0] & 0xf0) == 0x50 && u[1] == 0x2a && u[2] == 0x4d && u[3] == 0x18;
+            if (!skippable) {
+                const unsigned long long n = zs.getFrameContentSize(data + off, len);
+                if (n == Zstd::kSizeUnknown || n == Zstd::kSizeError) return false;
+                out.push_back({off, len, static_cast<std::size_t>(n)});
+            }
+            off += len;
+        }
+        return out.size() > 1;
+    }
+    // BGZF: every member carries its total size in a "BC" extra subfield
+    // and its decoded size (mod 2^32, at most 64 KiB here) in the trailer
+    for (std::size_t off = 0; off < size;) {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(data + off);
+        if (size - off < 18 || !gzip_at(data + off, 2) || !(u[3] & 4)) return false;
+        const std::size_t xlen = u[10] | u[11] << 8;
+        std::size_t bsize = 0;
+        for (std::size_t x = 12; x + 4 <= 12 + xlen && off + x + 4 <= size;) {
+            const std::size_t slen = u[x + 2] | u[x + 3] << 8;
+            if (u[x] == 'B' && u[x + 1] == 'C' && slen == 2 && off + x + 6 <= size) bsize = (u[x + 4] | u[x + 5] << 8) + 1u;
+            x += 4 + slen;
+        }
+        if (bsize < 18 || bsize > size - off) return false;
+        const unsigned char* t = u + bsize - 4;
+        const std::size_t isize = t[0] | t[1] << 8 | t[2] << 16 | static_cast<std::size_t>(t[3]) << 24;
+        if (isize) out.push_back({off, bsize, isize});   // the EOF marker member is empty
+        off += bsize;
+    }
+    return out.size() > 1;
+}
+
+// Decodes one frame into dst[0, f.decoded); dctx is the calling thread's.
+inline bool decode_frame(Codec c, const char* data, const Frame& f, char* dst, void*& zstd_ctx) {
+    if (c == Codec::Zstd) {
+        const Zstd& zs = Zstd::get();
+        if (!zstd_ctx && !(zstd_ctx = zs.createDCtx())) return false;
+        const std::size_t n = zs.decompressDCtx(zstd_ctx, dst, f.decoded, data + f.off, f.len);
+        if (zs.isError(n) || n != f.decoded) {
+            std::fprintf(stderr, "zstd: %s\n", zs.isError(n) ? zs.getErrorName(n) : "frame size mismatch");
+            return false;
+        }
+        return true;
+    }
+    const Zlib& zl = Zlib::get();
+    ZStream z;
+    if (!zl.init(z)) return false;
+    z.next_in = reinterpret_cast<const unsigned char*>(data + f.off);
+    z.avail_in = static_cast<unsigned>(f.len);
+    z.next_out = reinterpret_cast<unsigned char*>(dst);
+    z.avail_out = static_cast<unsigned>(f.decoded);
+    const int rc = zl.inflate(&z, 4 /* Z_FINISH */);
+    const bool ok = rc == Zlib::kStreamEnd && z.total_out == f.decoded;
+    zl.inflateEnd(&z);
+    if (!ok) std::fprintf(stderr, "gzip: corrupt BGZF member at byte %zu\n", f.off);
+    return ok;
+}
+
+}  // namespace codec_detail
+
+// Decodes a whole compressed buffer into out (replacing its contents).
+inline bool decode_all(Codec c, const char* data, std::size_t size, std::vector<char>& out) {
+    using namespace codec_detail;
+    if (!available(c)) return false;
+    StreamDecoder dec(c, data, size);
+    out.resize(std::max<std::size_t>(size * 4, 1 << 16));
+    std::size_t len = 0;
+    for (bool done = false; !done;) {
+        if (len == out.size()) out.resize(out.size() * 2);
+        const std::ptrdiff_t n = dec.read(out.data() + len, out.size() - len, done);
+        if (n < 0) return false;
+        len += static_cast<std::size_t>(n);
+    }
+    out.resize(len);
+    return true;
+}
+
+// Decodes the first (up to) cap bytes of the compressed file at path into
+// out, e.g. for a kernel probe; out is empty on failure.
+inline bool decode_head(Codec c, const char* path, std::size_t cap, std::vector<char>& out) {
+    using namespace codec_detail;
+    out.clear();
+    if (!available(c)) return false;
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    bool done = false;
+    StreamDecoder dec(c, static_cast<const char*>(p), size);
+    out.resize(cap);
+    const std::ptrdiff_t n = dec.read(out.data(), cap, done);
+    ::munmap(p, size);
+    out.resize(n > 0 ? static_cast<std::size_t>(n) : 0);
+    return n > 0;
+}
+
+// ---------- Decode pipeline ----------
+// Decoded units (a group of frames, or one 4 MiB streaming chunk) land in a
+// ring of slots: unit c in slot c % slots, which is reused once consumers
+// release unit c - slots, so decoders run at most `slots` units ahead of the
+// slowest parser. Same protocol as ChunkPipeline, except the unit count of a
+// streaming decode is only known when the decoder reaches the end.
+struct DecodeStats {
+    Codec         codec = Codec::None;
+    bool          parallel = false;   // independent frames
+    unsigned      decoders = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t in_bytes = 0;
+    std::uint64_t out_bytes = 0;
+    double        busy_seconds = 0.0;   // summed over decoder threads
+    double        seconds = 0.0;        // start to last unit decoded
+
+    void report(FILE* fp) const {
+        const double per_thread = busy_seconds > 0 ? static_cast<double>(out_bytes) / busy_seconds / 1e9 : 0.0;
+        std::fprintf(fp, "decode: %s, %.2f GB -> %.2f GB (x%.2f), ", codec_name(codec),
+                     static_cast<double>(in_bytes) / 1e9, static_cast<double>(out_bytes) / 1e9,
+                     in_bytes ? static_cast<double>(out_bytes) / static_cast<double>(in_bytes) : 0.0);
+        if (parallel) std::fprintf(fp, "%llu frames on %u threads", static_cast<unsigned long long>(frames), decoders);
+        else          std::fprintf(fp, "one stream");
+        std::fprintf(fp, ", %.3f s (%.2f GB/s out, %.2f GB/s per decoder thread)\n", seconds,
+                     seconds > 0 ? static_cast<double>(out_bytes) / seconds / 1e9 : 0.0, per_thread);
+    }
+};
+
+class DecodePipeline {
+public:
+    static constexpr std::size_t kChunk = 4 << 20;   // streaming unit; frame groups aim for this too
+
+    DecodePipeline() = default;
+    DecodePipeline(const DecodePipeline&) = delete;
+    DecodePipeline& operator=(const DecodePipeline&) = delete;
+    ~DecodePipeline() { finish(); }
+
+    // Starts decoding data[0, size), which stays mapped until finish().
+    bool start(const char* data, std::size_t size, Codec codec, unsigned slots, unsigned decoders) {
+        using namespace codec_detail;
+        if (!available(codec)) return false;
+        data_ = data;
+        codec_ = codec;
+        stats_ = DecodeStats{};
+        stats_.codec = codec;
+        stats_.in_bytes = size;
+        slots_.resize(std::max<unsigned>(slots, 2));
+        t0_ = std::chrono::steady_clock::now();
+
+        std::vector<Frame> frames;
+        if (decoders > 1 && split_frames(codec, data, size, frames)) {
+            // Consecutive frames grouped into units of about kChunk decoded bytes
+            for (std::size_t i = 0; i < frames.size();) {
+                const std::size_t first = i;
+                std::size_t bytes = 0;
+                while (i < frames.size() && (i == first || bytes + frames[i].decoded <= kChunk)) bytes += frames[i++].decoded;
+                units_.push_back({first, i, bytes});
+            }
+            frames_ = std::move(frames);
+            n_units_ = units_.size();
+            stats_.parallel = true;
+            stats_.frames = frames_.size();
+            stats_.decoders = static_cast<unsigned>(std::min<std::size_t>(decoders, units_.size()));
+            for (unsigned i = 0; i < stats_.decoders; ++i) decoders_.emplace_back([this] { decode_frames(); });
+        } else {
+            stats_.decoders = 1;
+            n_units_ = kUnknown;   // until the decoder reaches the end
+            decoders_.emplace_back([this, size] { decode_stream(size); });
+        }
+        return true;
+    }
+
+    // Blocks until unit c is decoded; false once c is past the last unit or
+    // after a failure (check failed()).
+    bool wait(std::uint64_t c, std::string_view& out) {
+        Slot& s = slots_[c % slots_.size()];
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [&] { return s.loaded == c || failed_ || c >= n_units_; });
+        if (s.loaded != c) return false;
+        out = std::string_view(s.buf.data(), s.len);
+        return true;
+    }
+
+    void release(std::uint64_t c) {
+        std::lock_guard<std::mutex> lk(mu_);
+        slots_[c % slots_.size()].released = c;
+        cv_.notify_all();
+    }
+
+    bool failed() const { return failed_.load(); }
+
+    // Joins the decoders; false if decoding failed. Finishing before every
+    // unit was consumed aborts them.
+    bool finish() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (done_ < n_units_) failed_ = true;
+            cv_.notify_all();
+        }
+        for (auto& t : decoders_) t.join();
+        decoders_.clear();
+        slots_.clear();
+        return !failed_;
+    }
+
+    const DecodeStats& stats() const { return stats_; }
+
+private:
+    static constexpr std::uint64_t kUnknown = UINT64_MAX;
+
+    struct Slot {
+        std::vector<char> buf;
+        std::size_t       len = 0;
+        std::uint64_t     loaded = UINT64_MAX;
+        std::uint64_t     released = UINT64_MAX;
+    };
+    struct Unit {
+        std::size_t first, last;   // frames [first, last)
+        std::size_t bytes;
+    };
+
+    bool slot_free(std::uint64_t c) const {
+        return c < slots_.size() || slots_[c % slots_.size()].released == c - slots_.size();
+    }
+
+    Slot* acquire(std::uint64_t c) {
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [&] { return slot_free(c) || failed_; });
+        return failed_ ? nullptr : &slots_[c % slots_.size()];
+    }
+
+    void publish(std::uint64_t c, std::size_t len, double busy) {
+        std::lock_guard<std::mutex> lk(mu_);
+        Slot& s = slots_[c % slots_.size()];
+        s.len = len;
+        s.loaded = c;
+        stats_.out_bytes += len;
+        stats_.busy_seconds += busy;
+        ++done_;
+        if (done_ == n_units_) {
+            stats_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0_).count();
+        }
+        cv_.notify_all();
+    }
+
+    void fail() {
+        std::lock_guard<std::mutex> lk(mu_);
+        failed_ = true;
+        cv_.notify_all();
+    }
+
+    static double since(std::chrono::steady_clock::time_point a) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - a).count();
+    }
+
+    void decode_frames() {
+        void* zctx = nullptr;
+        for (;;) {
+            const std::uint64_t u = next_unit_.fetch_add(1, std::memory_order_relaxed);
+            if (u >= n_units_) break;
+            Slot* s = acquire(u);
+            if (!s) break;
+            const auto a = std::chrono::steady_clock::now();
+            const Unit& un = units_[u];
+            s->buf.resize(un.bytes);
+            std::size_t pos = 0;
+            bool ok = true;
+            for (std::size_t f = un.first; ok && f < un.last; pos += frames_[f++].decoded) {
+                ok = codec_detail::decode_frame(codec_, data_, frames_[f], s->buf.data() + pos, zctx);
+            }
+            if (!ok) {
+                fail();
+                break;
+            }
+            publish(u, un.bytes, since(a));
+        }
+        if (zctx) codec_detail::Zstd::get().freeDCtx(zctx);
+    }
+
+    void decode_stream(std::size_t size) {
+        codec_detail::StreamDecoder dec(codec_, data_, size);
+        for (std::uint64_t c = 0;; ++c) {
+            Slot* s = acquire(c);
+            if (!s) return;
+            const auto a = std::chrono::steady_clock::now();
+            s->buf.resize(kChunk);
+            bool end = false;
+            const std::ptrdiff_t n = dec.read(s->buf.data(), kChunk, end);
+            if (n < 0) {
+                fail();
+                return;
+            }
+            if (n > 0) publish(c, static_cast<std::size_t>(n), since(a));
+            if (end) {
+                std::lock_guard<std::mutex> lk(mu_);
+                n_units_ = n > 0 ? c + 1 : c;
+                done_ = n_units_;
+                stats_.seconds = since(t0_);
+                cv_.notify_all();
+                return;
+            }
+        }
+    }
+
+    const char*              data_ = nullptr;
+    Codec                    codec_ = Codec::None;
+    std::vector<codec_detail::Frame> frames_;
+    std::vector<Unit>        units_;
+    std::vector<Slot>        slots_;
+    std::vector<std::thread> decoders_;
+    std::mutex               mu_;
+    std::condition_variable  cv_;
+    std::atomic<bool>        failed_{false};
+    std::atomic<std::uint64_t> next_unit_{0};
+    std::uint64_t            n_units_ = 0;
+    std::uint64_t            done_ = 0;
+    DecodeStats              stats_;
+    std::chrono::steady_clock::time_point t0_;
+};
@@ -0,0 +1,136 @@
+// delim_scan.hpp
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BRC_X86 1
+#endif
+
+// ---------- Delimiter scanner ----------
+// Classifies input 64 bytes at a time: bit i of semi[b] / nl[b] is set when
+// byte 64*b + i is ';' / '\n'. The record loop then walks these bitmasks
+// instead of calling memchr twice per line, so each input byte is compared
+// once. A scan call covers many blocks so the dispatch cost is amortised.
+//
+// Every block passed in must be 64 readable bytes; callers copy a short tail
+// into a padded buffer and mask off the bits past the end.
+using ScanBlocksFn = void (*)(const char* p, std::size_t n_blocks,
+                              std::uint64_t* semi, std::uint64_t* nl);
+
+static void scan_blocks_scalar(const char* p, std::size_t n_blocks,
+                               std::uint64_t* semi, std::uint64_t* nl) {
+    for (std::size_t b = 0; b < n_blocks; ++b, p += 64) {
+        std::uint64_t s = 0, l = 0;
+        for (unsigned i = 0; i < 64; ++i) {
+            s |= static_cast<std::uint64_t>(p[i] == ';') << i;
+            l |= static_cast<std::uint64_t>(p[i] == '\n') << i;
+        }
+        semi[b] = s;
+        nl[b] = l;
+    }
+}
+
+#ifdef BRC_X86
+__attribute__((target("sse2")))
+static void scan_blocks_sse2(const char* p, std::size_t n_blocks,
+                             std::uint64_t* semi, std::uint64_t* nl) {
+    const __m128i vs = _mm_set1_epi8(';');
+    const __m128i vl = _mm_set1_epi8('\n');
+    for (std::size_t b = 0; b < n_blocks; ++b, p += 64) {
+        std::uint64_t s = 0, l = 0;
+        for (unsigned k = 0; k < 4; ++k) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+            s |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+                     _mm_movemask_epi8(_mm_cmpeq_epi8(v, vs)))) << (16 * k);
+            l |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+                     _mm_movemask_epi8(_mm_cmpeq_epi8(v, vl)))) << (16 * k);
+        }
+        semi[b] = s;
+        nl[b] = l;
+    }
+}
+
+__attribute__((target("avx2")))
+static void scan_blocks_avx2(const char* p, std::size_t n_blocks,
+                             std::uint64_t* semi, std::uint64_t* nl) {
+    const __m256i vs = _mm256_set1_epi8(';');
+    const __m256i vl = _mm256_set1_epi8('\n');
+    for (std::size_t b = 0; b < n_blocks; ++b, p += 64) {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        std::uint64_t s_lo = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vs)));
+        std::uint64_t s_hi = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vs)));
+        std::uint64_t l_lo = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vl)));
+        std::uint64_t l_hi = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vl)));
+        semi[b] = s_lo | (s_hi << 32);
+        nl[b] = l_lo | (l_hi << 32);
+    }
+}
+#endif
+
+// Picks the widest scanner this CPU supports (CPUID via __builtin_cpu_supports).
+inline ScanBlocksFn select_scanner(const char** name = nullptr) {
+#ifdef BRC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        if (name) *name = "avx2";
+        return scan_blocks_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        if (name) *name = "sse2";
+        return scan_blocks_sse2;
+    }
+#endif
+    if (name) *name = "scalar";
+    return scan_blocks_scalar;
+}
+
+// ---------- Record loop over the bitmasks ----------
+// Calls f(line, sep, line_end) for every record in [data, data+size): sep is
+// the first ';' in the line (nullptr if there is none) and line_end points at
+// the '\n' (or at data+size for an unterminated last line).
+template <class F>
+inline void for_each_record(ScanBlocksFn scan, const char* data, std::size_t size, F&& f) {
+    constexpr std::size_t kBatch = 64;  // 4 KiB of input per scan call
+    std::uint64_t semi[kBatch], nl[kBatch];
+    alignas(64) char tail[64];
+
+    std::size_t line = 0;
+    std::size_t sep  = SIZE_MAX;
+
+    auto walk = [&](std::size_t base, std::uint64_t s, std::uint64_t l) {
+        std::uint64_t events = s | l;
+        while (events) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctzll(events));
+            events &= events - 1;
+            std::size_t pos = base + bit;
+            if ((l >> bit) & 1) {
+                f(data + line, sep == SIZE_MAX ? nullptr : data + sep, data + pos);
+                line = pos + 1;
+                sep = SIZE_MAX;
+            } else if (sep == SIZE_MAX) {
+                sep = pos;
+            }
+        }
+    };
+
+    const std::size_t full = size / 64;
+    for (std::size_t b0 = 0; b0 < full; b0 += kBatch) {
+        std::size_t nb = full - b0 < kBatch ? full - b0 : kBatch;
+        scan(data + 64 * b0, nb, semi, nl);
+        for (std::size_t b = 0; b < nb; ++b) walk(64 * (b0 + b), semi[b], nl[b]);
+    }
+
+    const std::size_t rest = size - 64 * full;
+    if (rest) {
+        std::memcpy(tail, data + 64 * full, rest);
+        std::memset(tail + rest, 0, 64 - rest);
+        scan(tail, 1, semi, nl);
+        walk(64 * full, semi[0], nl[0]);
+    }
+
+    if (line < size) f(data + line, sep == SIZE_MAX ? nullptr : data + sep, data + size);
+}
@@ -0,0 +1,333 @@
+// extended_stats.hpp
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "city_result.hpp"
+
+// ---------- Welford variance ----------
+// Running mean and sum of squared deviations, updated per sample without the
+// cancellation of sum(x^2) - n*mean^2. Partials combine with Chan et al.'s
+// pairwise formula; like NeumaierSum, the last bits depend on merge order.
+struct Welford {
+    std::uint64_t n = 0;
+    double        mean = 0.0;
+    double        m2 = 0.0;
+
+    void add(double v) noexcept {
+        ++n;
+        const double d = v - mean;
+        mean += d / static_cast<double>(n);
+        m2 += d * (v - mean);
+    }
+
+    void merge(const Welford& o) noexcept {
+        if (!o.n) return;
+        if (!n) {
+            *this = o;
+            return;
+        }
+        const double na = static_cast<double>(n), nb = static_cast<double>(o.n), total = na + nb;
+        const double d = o.mean - mean;
+        mean += d * nb / total;
+        m2 += o.m2 + d * d * na * nb / total;
+        n += o.n;
+    }
+
+    // Sample variance (n - 1 denominator, as pandas' std); 0 below two samples.
+    double variance() const noexcept { return n > 1 ? m2 / static_cast<double>(n - 1) : 0.0; }
+    double stddev() const noexcept { return std::sqrt(variance()); }
+
+    bool save(FILE* fp) const { return std::fwrite(this, sizeof *this, 1, fp) == 1; }
+    bool load(FILE* fp) { return std::fread(this, sizeof *this, 1, fp) == 1; }
+};
+
+// ---------- Quantile sketch ----------
+// DDSketch with a log-linear bucket mapping: a nonzero value goes to the
+// bucket named by the exponent and top kBits mantissa bits of |v|, i.e. a
+// shift of its bit pattern instead of a log() call. A bucket spans at most
+// 2^-kBits of its lower bound, so its midpoint is within 2^-(kBits+1) relative
+// error of every value in it (0.78% for kBits = 6). Positive and negative
+// magnitudes keep separate dense count arrays over the key span seen so far;
+// sketches merge by adding counts, exactly and in any order. A span wider
+// than kMaxBins collapses its smallest magnitudes into the lowest bucket kept,
+// as DDSketch's collapsing store does, so memory stays bounded per station.
+class QuantileSketch {
+public:
+    static constexpr int          kBits = 6;
+    static constexpr std::int32_t kMaxBins = 2048;   // 32 binades per sign
+
+    void add(double v) {
+        if (v > 0.0)      pos_.add(key_of(v), 1);
+        else if (v < 0.0) neg_.add(key_of(-v), 1);
+        else              ++zero_;
+    }
+
+    void merge(const QuantileSketch& o) {
+        pos_.merge(o.pos_);
+        neg_.merge(o.neg_);
+        zero_ += o.zero_;
+    }
+
+    std::uint64_t count() const noexcept { return pos_.total + neg_.total + zero_; }
+    std::size_t   heap_bytes() const noexcept { return (pos_.counts.capacity() + neg_.counts.capacity()) * sizeof(std::uint32_t); }
+
+    // Value at rank q * (count - 1), q in [0, 1]; NaN when empty.
+    double quantile(double q) const noexcept {
+        const std::uint64_t n = count();
+        if (!n) return std::numeric_limits<double>::quiet_NaN();
+        const double rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(n - 1);
+        std::uint64_t seen = 0;
+        // Most negative first: the negative store from its largest magnitude down
+        for (std::size_t i = neg_.counts.size(); i-- > 0;) {
+            if ((seen += neg_.counts[i]) > rank) return -value_of(neg_.base + static_cast<std::int32_t>(i));
+        }
+        if ((seen += zero_) > rank) return 0.0;
+        for (std::size_t i = 0; i < pos_.counts.size(); ++i) {
+            if ((seen += pos_.counts[i]) > rank) return value_of(pos_.base + static_cast<std::int32_t>(i));
+        }
+        return value_of(pos_.base + static_cast<std::int32_t>(pos_.counts.size()) - 1);
+    }
+
+    bool save(FILE* fp) const { return pos_.save(fp) && neg_.save(fp) && std::fwrite(&zero_, sizeof zero_, 1, fp) == 1; }
+    bool load(FILE* fp) { return pos_.load(fp) && neg_.load(fp) && std::fread(&zero_, sizeof zero_, 1, fp) == 1; }
+
+private:
+    static std::int32_t key_of(double a) noexcept {
+        std::uint64_t b;
+        std::memcpy(&b, &a, sizeof b);
+        return static_cast<std::int32_t>(b >> (52 - kBits));
+    }
+
+    static double value_of(std::int32_t k) noexcept {
+        auto bound = [](std::uint64_t key) {
+            const std::uint64_t b = key << (52 - kBits);
+            double d;
+            std::memcpy(&d, &b, sizeof d);
+            return d;
+        };
+        const double lo = bound(static_cast<std::uint64_t>(k)), hi = bound(static_cast<std::uint64_t>(k) + 1);
+        return lo + (hi - lo) / 2;
+    }
+
+    // Counts for keys [base, base + counts.size()).
+    struct Store {
+        std::int32_t               base = 0;
+        std::vector<std::uint32_t> counts;
+        std::uint64_t              total = 0;
+
+        void add(std::int32_t k, std::uint32_t n) {
+            if (counts.empty() || k < base || k >= base + static_cast<std::int32_t>(counts.size())) k = make_room(k);
+            counts[static_cast<std::size_t>(k - base)] += n;
+            total += n;
+        }
+
+        // Widens once to o's occupied span, then adds bin by bin.
+        void merge(const Store& o) {
+            if (!o.total) return;
+            std::size_t first = 0, last = o.counts.size() - 1;
+            while (!o.counts[first]) ++first;
+            while (!o.counts[last]) --last;
+            const std::int32_t lo = o.base + static_cast<std::int32_t>(first), hi = o.base + static_cast<std::int32_t>(last);
+            if (counts.empty() || lo < base) make_room(lo);
+            if (hi >= base + static_cast<std::int32_t>(counts.size())) make_room(hi);
+            for (std::size_t i = first; i <= last; ++i) {
+                const std::int32_t k = std::max(o.base + static_cast<std::int32_t>(i), base);   // below base: collapsed
+                counts[static_cast<std::size_t>(k - base)] += o.counts[i];
+            }
+            total += o.total;
+        }
+
+        // Widens the span to cover k, with headroom in the direction it grew;
+        // returns k, or the lowest key kept if k had to collapse into it.
+        std::int32_t make_room(std::int32_t k) {
+            if (counts.empty()) {
+                base = k - 8;
+                counts.assign(32, 0);
+                return k;
+            }
+            const std::int32_t size = static_cast<std::int32_t>(counts.size());
+            std::int32_t lo = std::min(base, k), hi = std::max(base + size - 1, k);
+            if (hi - lo + 1 > kMaxBins) {
+                lo = hi - kMaxBins + 1;
+            } else {
+                const std::int32_t extra = std::min(size / 2, kMaxBins - (hi - lo + 1));
+                if (k < base) lo -= extra;
+                else          hi += extra;
+            }
+            std::vector<std::uint32_t> next(static_cast<std::size_t>(hi - lo + 1), 0);
+            for (std::int32_t i = 0; i < size; ++i) {
+                next[static_cast<std::size_t>(std::max(base + i, lo) - lo)] += counts[static_cast<std::size_t>(i)];
+            }
+            counts.swap(next);
+            base = lo;
+            return std::max(k, lo);
+        }
+
+        bool save(FILE* fp) const {
+            const std::uint32_t n = static_cast<std::uint32_t>(counts.size());
+            return std::fwrite(&base, sizeof base, 1, fp) == 1 && std::fwrite(&n, sizeof n, 1, fp) == 1 &&
+                   std::fwrite(counts.data(), sizeof(std::uint32_t), n, fp) == n;
+        }
+        bool load(FILE* fp) {
+            std::uint32_t n = 0;
+            if (std::fread(&base, sizeof base, 1, fp) != 1 || std::fread(&n, sizeof n, 1, fp) != 1 ||
+                n > static_cast<std::uint32_t>(kMaxBins) * 2) return false;
+            counts.assign(n, 0);
+            if (std::fread(counts.data(), sizeof(std::uint32_t), n, fp) != n) return false;
+            total = 0;
+            for (std::uint32_t c : counts) total += c;
+            return true;
+        }
+    };
+
+    Store         pos_;
+    Store         neg_;
+    std::uint64_t zero_ = 0;
+};
+
+// ---------- Extended station results ----------
+// CityResult plus the statistics selected by a StatFlags mask. The extra
+// state lives behind one pointer, allocated on a station's first sample, so
+// the result stays inside a 64-byte StationSlot: 40 bytes with the default
+// accumulator, leaving an 8-byte name prefix, and 48 with NeumaierSum or
+// another 24-byte one, leaving none (names are then compared in the arena).
+// The plain path never sees any of this: without BRC_STATS, DefaultResult is
+// CityResult<> itself.
+enum StatFlags : unsigned {
+    kStatVariance  = 1,   // stddev
+    kStatQuantiles = 2,   // p50, p95, p99
+};
+
+struct NoStat {
+    void add(double) noexcept {}
+    void merge(const NoStat&) noexcept {}
+    bool save(FILE*) const { return true; }
+    bool load(FILE*) { return true; }
+};
+
+template <unsigned Stats, class Accum = DefaultAccum>
+struct ExtendedResult : CityResult<Accum> {
+    static_assert(Stats != 0 && Stats <= (kStatVariance | kStatQuantiles), "unknown StatFlags");
+    using Base = CityResult<Accum>;
+    using accum_type = Accum;
+
+    static constexpr unsigned      kStats = Stats;
+    static constexpr std::uint32_t kTag = Accum::kTag | Stats << 24;   // checkpoint compatibility
+    static constexpr std::size_t   kExtraColumns = (Stats & kStatVariance ? 1 : 0) + (Stats & kStatQuantiles ? 3 : 0);
+
+    struct Extras {
+        [[no_unique_address]] std::conditional_t<(Stats & kStatVariance) != 0, Welford, NoStat>        welford;
+        [[no_unique_address]] std::conditional_t<(Stats & kStatQuantiles) != 0, QuantileSketch, NoStat> sketch;
+
+        void add(double v) {
+            welford.add(v);
+            sketch.add(v);
+        }
+        void merge(const Extras& o) {
+            welford.merge(o.welford);
+            sketch.merge(o.sketch);
+        }
+    };
+
+    std::unique_ptr<Extras> extras;   // null until the first sample
+
+    ExtendedResult() = default;
+    ExtendedResult(const ExtendedResult& o) : Base(o), extras(clone(o.extras)) {}
+    ExtendedResult(ExtendedResult&&) noexcept = default;
+    ExtendedResult& operator=(const ExtendedResult& o) {
+        if (this != &o) {
+            Base::operator=(o);
+            extras = clone(o.extras);
+        }
+        return *this;
+    }
+    ExtendedResult& operator=(ExtendedResult&&) noexcept = default;
+
+    void update(double v) {
+        Base::update(v);
+        extra().add(v);
+    }
+
+    template <int N>
+    void update_units(double v, std::int64_t u) {
+        Base::template update_units<N>(v, u);
+        extra().add(v);
+    }
+
+    // The block forms reduce min/max/sum in the base; the extras still see
+    // every value.
+    void update_block(const double* v, std::size_t n) {
+        Base::update_block(v, n);
+        Extras& x = extra();
+        for (std::size_t i = 0; i < n; ++i) x.add(v[i]);
+    }
+
+    template <int N>
+    void update_units_block(const double* v, const std::int64_t* u, std::size_t n) {
+        Base::template update_units_block<N>(v, u, n);
+        Extras& x = extra();
+        for (std::size_t i = 0; i < n; ++i) x.add(v[i]);
+    }
+
+    void merge(const ExtendedResult& o) {
+        Base::merge(o);
+        if (!o.extras) return;
+        if (extras) extras->merge(*o.extras);
+        else        extras = clone(o.extras);
+    }
+
+    // stddev, then p50/p95/p99, for whichever are enabled. Quantiles are
+    // clamped to [min, max], so a single-valued station reports it exactly.
+    // NaN for a result that came without samples (e.g. from block headers).
+    void extra_columns(double* out) const {
+        constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+        if constexpr ((Stats & kStatVariance) != 0) *out++ = extras ? extras->welford.stddev() : kNaN;
+        if constexpr ((Stats & kStatQuantiles) != 0) {
+            for (double q : {0.50, 0.95, 0.99}) {
+                *out++ = extras ? std::clamp(extras->sketch.quantile(q), this->min, this->max) : kNaN;
+            }
+        }
+    }
+
+    // Checkpoint records: the plain fields raw, then the extra state.
+    bool save(FILE* fp) const {
+        const Base& b = *this;
+        const std::uint8_t has = extras != nullptr;
+        return std::fwrite(&b, sizeof b, 1, fp) == 1 && std::fwrite(&has, 1, 1, fp) == 1 &&
+               (!has || (extras->welford.save(fp) && extras->sketch.save(fp)));
+    }
+    bool load(FILE* fp) {
+        Base& b = *this;
+        std::uint8_t has = 0;
+        if (std::fread(&b, sizeof b, 1, fp) != 1 || std::fread(&has, 1, 1, fp) != 1) return false;
+        extras.reset();
+        if (!has) return true;
+        extras = std::make_unique<Extras>();
+        return extras->welford.load(fp) && extras->sketch.load(fp);
+    }
+
+private:
+    Extras& extra() {
+        if (!extras) [[unlikely]] extras = std::make_unique<Extras>();
+        return *extras;
+    }
+
+    static std::unique_ptr<Extras> clone(const std::unique_ptr<Extras>& p) {
+        return p ? std::make_unique<Extras>(*p) : nullptr;
+    }
+};
+
+// Result type used by the solution. Build with e.g. -DBRC_STATS=3 for
+// stddev and quantiles (a StatFlags mask); 0, the default, is the plain path.
+#ifndef BRC_STATS
+#define BRC_STATS 0
+#endif
+using DefaultResult = std::conditional_t<BRC_STATS == 0, CityResult<>, ExtendedResult<BRC_STATS>>;
@@ -0,0 +1,331 @@
+// file_set.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "compressed_input.hpp"
+#include "map_tuning.hpp"
+#include "scheduler.hpp"
+
+// ---------- Input file sets ----------
+// Inputs named on the command line: files, directories (their regular files,
+// not recursing, dotfiles skipped) and glob patterns. Files come out in the
+// order named, directory and glob matches sorted by name; a file reached
+// twice (same device and inode) is kept once; empty files are dropped.
+// gzip and zstd files are recognised by their first bytes.
+
+struct InputFile {
+    std::string   path;
+    std::uint64_t size = 0;
+    std::uint64_t dev = 0;
+    std::uint64_t ino = 0;
+    Codec         codec = Codec::None;
+};
+
+namespace file_set_detail {
+
+inline bool has_glob_chars(const std::string& s) { return s.find_first_of("*?[") != std::string::npos; }
+
+// `listed`: the path came from a directory or glob, so anything that is not
+// a regular file is skipped rather than reported.
+inline bool add_file(const std::string& path, bool listed, std::vector<InputFile>& out) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        std::perror(path.c_str());
+        return false;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        if (listed) return true;
+        std::fprintf(stderr, "%s: not a regular file\n", path.c_str());
+        return false;
+    }
+    const std::uint64_t dev = static_cast<std::uint64_t>(st.st_dev), ino = static_cast<std::uint64_t>(st.st_ino);
+    for (const InputFile& f : out) {
+        if (f.dev == dev && f.ino == ino) return true;
+    }
+    if (st.st_size > 0) out.push_back({path, static_cast<std::uint64_t>(st.st_size), dev, ino, sniff_codec(path.c_str())});
+    return true;
+}
+
+inline bool add_directory(const std::string& dir, std::vector<InputFile>& out) {
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) {
+        std::perror(dir.c_str());
+        return false;
+    }
+    std::vector<std::string> names;
+    while (const dirent* e = ::readdir(d)) {
+        if (e->d_name[0] != '.') names.emplace_back(e->d_name);
+    }
+    ::closedir(d);
+    std::sort(names.begin(), names.end());
+    const std::string prefix = dir.ends_with('/') ? dir : dir + '/';
+    for (const std::string& n : names) {
+        if (!add_file(prefix + n, true, out)) return false;
+    }
+    return true;
+}
+
+}  // namespace file_set_detail
+
+inline bool expand_inputs(const std::vector<std::string>& specs, std::vector<InputFile>& out) {
+    using namespace file_set_detail;
+    for (const std::string& spec : specs) {
+        struct stat st;
+        if (::stat(spec.c_str(), &st) == 0) {
+            if (!(S_ISDIR(st.st_mode) ? add_directory(spec, out) : add_file(spec, false, out))) return false;
+            continue;
+        }
+        if (!has_glob_chars(spec)) {
+            std::perror(spec.c_str());
+            return false;
+        }
+        glob_t g{};
+        const int rc = ::glob(spec.c_str(), 0, nullptr, &g);   // sorted matches
+        if (rc != 0) {
+            std::fprintf(stderr, "%s: %s\n", spec.c_str(), rc == GLOB_NOMATCH ? "no match" : "glob failed");
+            ::globfree(&g);
+            return false;
+        }
+        bool ok = true;
+        for (std::size_t i = 0; ok && i < g.gl_pathc; ++i) ok = add_file(g.gl_pathv[i], true, out);
+        ::globfree(&g);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// ---------- File-set reader ----------
+// One claim queue over every file, for one pool of worker threads. A file no
+// larger than a morsel is one piece and is read() whole into the claiming
+// worker's buffer: no mapping, page-table setup or munmap for the common
+// small shard. Larger files are mapped once, by whichever worker claims
+// their first piece, split into raw morsel ranges snapped to line starts as
+// MorselCursor does, and unmapped when their last piece is released, so the
+// address space in use stays near the number of files being worked on.
+// Pieces are queued largest file first, so the small files fill the tail.
+// A compressed file is one claim whatever its size: the claiming worker maps
+// it and streams it through a decoder a morsel at a time, each morsel's whole
+// lines one piece, so shards decode in parallel with each other and a worker
+// holds one decoded morsel (and a cut line), never the whole shard.
+class FileSetReader {
+public:
+    struct Piece {
+        std::string_view bytes;   // whole lines, from one file
+        std::uint32_t    file = 0;
+        bool             more = false;   // the same worker's next piece continues this decoded file
+    };
+
+    // A worker's read buffer, and the compressed file it is decoding, if any.
+    struct Buffer {
+        std::vector<char>                             bytes;
+        std::unique_ptr<codec_detail::StreamDecoder> decoder;
+        std::uint32_t                                 file = 0;
+        std::size_t                                   cut = 0;   // bytes [cut, len) start the next piece
+        std::size_t                                   len = 0;
+    };
+
+    FileSetReader(std::vector<InputFile> files, std::size_t morsel, const MapOptions& mo)
+        : files_(std::move(files)), morsel_(morsel), mo_(mo), state_(new FileState[files_.size()]) {
+        order_.resize(files_.size());
+        for (std::uint32_t i = 0; i < order_.size(); ++i) order_[i] = i;
+        std::stable_sort(order_.begin(), order_.end(),
+                         [&](std::uint32_t a, std::uint32_t b) { return files_[a].size > files_[b].size; });
+        first_piece_.reserve(order_.size() + 1);
+        std::size_t pieces = 0;
+        for (std::uint32_t f : order_) {
+            first_piece_.push_back(pieces);
+            const std::size_t n = pieces_of(f);
+            state_[f].remaining = static_cast<std::uint32_t>(n);
+            pieces += n;
+        }
+        first_piece_.push_back(pieces);
+    }
+
+    FileSetReader(const FileSetReader&) = delete;
+    FileSetReader& operator=(const FileSetReader&) = delete;
+    ~FileSetReader() {
+        for (std::size_t f = 0; f < files_.size(); ++f) unmap(f);
+    }
+
+    // Claims the next non-empty piece; buf is the calling worker's read
+    // buffer. False once drained, or for every caller after an I/O error.
+    bool next(Buffer& buf, Piece& out) {
+        while (!failed_.load(std::memory_order_relaxed)) {
+            if (buf.decoder) {
+                if (!decode_piece(buf, out)) break;
+                if (!out.bytes.empty()) return true;
+                release(out);   // nothing after the last newline
+                continue;
+            }
+            const std::size_t k = next_.fetch_add(1, std::memory_order_relaxed);
+            if (k >= first_piece_.back()) return false;
+            const std::size_t j = static_cast<std::size_t>(
+                std::upper_bound(first_piece_.begin(), first_piece_.end(), k) - first_piece_.begin()) - 1;
+            const std::uint32_t f = order_[j];
+            out.file = f;
+            out.more = false;
+            if (files_[f].codec != Codec::None) {
+                const FileState& fs = mapped(f);
+                if (!fs.map || !codec_detail::available(files_[f].codec)) break;
+                buf.decoder = std::make_unique<codec_detail::StreamDecoder>(files_[f].codec, fs.map,
+                                                                            static_cast<std::size_t>(files_[f].size));
+                buf.file = f;
+                buf.cut = buf.len = 0;
+                decoded_files_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (files_[f].size <= morsel_) {
+                if (!read_whole(f, buf.bytes)) break;
+                out.bytes = std::string_view(buf.bytes.data(), buf.bytes.size());
+                return true;
+            }
+            const FileState& fs = mapped(f);
+            if (!fs.map) break;
+            const std::size_t size = files_[f].size, lo = (k - first_piece_[j]) * morsel_;
+            const std::size_t begin = line_start_at(fs.map, size, lo);
+            const std::size_t end = line_start_at(fs.map, size, std::min(size, lo + morsel_));
+            out.bytes = std::string_view(fs.map + begin, end - begin);
+            if (end > begin) return true;
+            release(out);   // a line longer than the morsel swallowed it
+        }
+        failed_ = true;
+        return false;
+    }
+
+    // Call once per piece from next(), after parsing it.
+    void release(const Piece& p) {
+        if (p.more) return;   // a decoded file counts once, at its last piece
+        if (state_[p.file].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) unmap(p.file);
+    }
+
+    bool failed() const { return failed_.load(); }
+    std::size_t morsel() const { return morsel_; }
+    const std::vector<InputFile>& files() const { return files_; }
+    std::size_t read_files() const { return read_files_.load(); }
+    std::size_t mapped_files() const { return mapped_files_.load(); }
+    std::size_t decoded_files() const { return decoded_files_.load(); }
+
+private:
+    struct FileState {
+        std::once_flag             once;
+        const char*                map = nullptr;
+        std::atomic<std::uint32_t> remaining{0};
+    };
+
+    std::size_t pieces_of(std::uint32_t f) const {
+        if (files_[f].codec != Codec::None) return 1;
+        return static_cast<std::size_t>((files_[f].size + morsel_ - 1) / morsel_);
+    }
+
+    // The next morsel of buf's decoded file, cut after its last newline; the
+    // cut line moves to the front and is finished by the next piece. The
+    // window grows only for a line longer than a morsel.
+    bool decode_piece(Buffer& buf, Piece& out) {
+        if (buf.cut) {
+            std::memmove(buf.bytes.data(), buf.bytes.data() + buf.cut, buf.len - buf.cut);
+            buf.len -= buf.cut;
+        }
+        bool done = false;
+        const char* nl = nullptr;
+        while (!nl && !done) {
+            if (buf.bytes.size() < buf.len + morsel_) buf.bytes.resize(buf.len + morsel_);
+            const std::ptrdiff_t n = buf.decoder->read(buf.bytes.data() + buf.len, morsel_, done);
+            if (n < 0) {
+                std::fprintf(stderr, "%s: could not decode\n", files_[buf.file].path.c_str());
+                buf.decoder.reset();
+                return false;
+            }
+            nl = static_cast<const char*>(::memrchr(buf.bytes.data() + buf.len, '\n', static_cast<std::size_t>(n)));
+            buf.len += static_cast<std::size_t>(n);
+        }
+        buf.cut = done ? buf.len : static_cast<std::size_t>(nl - buf.bytes.data()) + 1;
+        out.bytes = std::string_view(buf.bytes.data(), buf.cut);
+        out.file = buf.file;
+        out.more = !done;
+        if (done) buf.decoder.reset();
+        return true;
+    }
+
+    // The file as listed; one that shrank since is read up to its new end.
+    bool read_whole(std::uint32_t f, std::vector<char>& buf) {
+        const InputFile& in = files_[f];
+        const int fd = ::open(in.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::perror(in.path.c_str());
+            return false;
+        }
+        buf.resize(static_cast<std::size_t>(in.size));
+        std::size_t got = 0;
+        while (got < buf.size()) {
+            const ssize_t r = ::pread(fd, buf.data() + got, buf.size() - got, static_cast<off_t>(got));
+            if (r < 0) {
+                std::perror(in.path.c_str());
+                ::close(fd);
+                return false;
+            }
+            if (r == 0) break;
+            got += static_cast<std::size_t>(r);
+        }
+        ::close(fd);
+        buf.resize(got);
+        read_files_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    const FileState& mapped(std::uint32_t f) {
+        FileState& fs = state_[f];
+        std::call_once(fs.once, [&] {
+            const InputFile& in = files_[f];
+            const int fd = ::open(in.path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                std::perror(in.path.c_str());
+                return;
+            }
+            void* p = ::mmap(nullptr, static_cast<std::size_t>(in.size), PROT_READ, map_flags(mo_), fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) {
+                std::perror(in.path.c_str());
+                return;
+            }
+            apply_madvise(p, static_cast<std::size_t>(in.size), mo_);
+            fs.map = static_cast<const char*>(p);
+            if (in.codec == Codec::None) mapped_files_.fetch_add(1, std::memory_order_relaxed);
+        });
+        return fs;
+    }
+
+    void unmap(std::size_t f) {
+        FileState& fs = state_[f];
+        if (fs.map) ::munmap(const_cast<char*>(fs.map), static_cast<std::size_t>(files_[f].size));
+        fs.map = nullptr;
+    }
+
+    std::vector<InputFile>       files_;
+    std::size_t                  morsel_;
+    MapOptions                   mo_;
+    std::unique_ptr<FileState[]> state_;
+    std::vector<std::uint32_t>   order_;         // files, largest first
+    std::vector<std::size_t>     first_piece_;   // first piece index of order_[j]; total at the end
+    std::atomic<std::size_t>     next_{0};
+    std::atomic<bool>            failed_{false};
+    std::atomic<std::size_t>     read_files_{0};
+    std::atomic<std::size_t>     mapped_files_{0};
+    std::atomic<std::size_t>     decoded_files_{0};
+};
@@ -0,0 +1,304 @@
+// format_results.hpp
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// ---------- Fixed-precision formatting ----------
+// format_fixed(v, d) produces exactly what printf("%.*f", d, v) does: the
+// binary value m * 2^e is scaled by 10^d with 128-bit integer arithmetic and
+// rounded half-to-even on the exact remainder, so there is no intermediate
+// double rounding. Values whose scaled magnitude does not fit in 64 bits
+// (|v| * 10^d >= 2^64), non-finite values and d > 19 fall back to snprintf.
+
+// Bytes format_fixed may write for `decimals`, fallback included
+// (%.*f of DBL_MAX is 309 integer digits).
+constexpr std::size_t max_fixed_len(int decimals) {
+    return 1 + 309 + 1 + static_cast<std::size_t>(decimals < 0 ? 0 : decimals) + 1;
+}
+
+namespace format_detail {
+
+constexpr std::uint64_t kPow10[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull,
+};
+
+// |v| * 10^d rounded half-to-even; false if it does not fit in 64 bits.
+inline bool scale_round(std::uint64_t m, int e, int d, std::uint64_t& q) {
+    using u128 = unsigned __int128;
+    if (m == 0) { q = 0; return true; }
+    if (e >= 0) {
+        if (e > 11) return false;
+        const u128 prod = static_cast<u128>(m << e) * kPow10[d];
+        if (prod >> 64) return false;
+        q = static_cast<std::uint64_t>(prod);
+        return true;
+    }
+    const int s = -e;
+    const u128 prod = static_cast<u128>(m) * kPow10[d];   // < 2^117
+    if (s >= 118) { q = 0; return true; }                 // below half a unit
+    const u128 whole = prod >> s;
+    if (whole >> 64) return false;
+    const u128 rem = prod & ((u128{1} << s) - 1);
+    const u128 half = u128{1} << (s - 1);
+    q = static_cast<std::uint64_t>(whole);
+    if (rem > half || (rem == half && (q & 1))) {
+        if (++q == 0) return false;
+    }
+    return true;
+}
+
+}  // namespace format_detail
+
+inline char* format_fixed(char* p, double v, int decimals) {
+    using namespace format_detail;
+    if (decimals < 0) decimals = 0;
+    if (decimals <= 19 && std::isfinite(v)) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof bits);
+        const int bexp = static_cast<int>((bits >> 52) & 0x7ff);
+        std::uint64_t m = bits & ((std::uint64_t{1} << 52) - 1);
+        int e = -1074;
+        if (bexp) { m |= std::uint64_t{1} << 52; e = bexp - 1075; }
+
+        std::uint64_t q;
+        if (scale_round(m, e, decimals, q)) {
+            if (bits >> 63) *p++ = '-';   // printf keeps the sign of -0.0 and of negatives that round to 0
+            const std::uint64_t div = kPow10[decimals];
+            p = std::to_chars(p, p + 20, q / div).ptr;
+            if (decimals) {
+                *p++ = '.';
+                std::uint64_t frac = q % div;
+                for (int k = decimals - 1; k >= 0; --k, frac /= 10) p[k] = static_cast<char>('0' + frac % 10);
+                p += decimals;
+            }
+            return p;
+        }
+    }
+    return p + std::snprintf(p, max_fixed_len(decimals), "%.*f", decimals, v);
+}
+
+// ---------- Name sort ----------
+// MSD radix sort over 8-byte big-endian key windows: each level runs an LSD
+// byte radix on the cached 64-bit window (skipping byte positions where every
+// key agrees), then recurses into runs that share the window. Comparing the
+// windows as unsigned integers orders names bytewise, i.e. by UTF-8 code
+// point, which is the 1BRC canonical order. Small runs go to std::sort.
+template <class Result>
+struct NamedResult {
+    std::uint64_t     key;    // name bytes [depth, depth + 8), zero padded
+    std::string_view  name;
+    const Result*     value;
+};
+
+namespace format_detail {
+
+inline std::uint64_t key_window(std::string_view s, std::size_t depth) {
+    if (s.size() >= depth + 8) {
+        std::uint64_t k;
+        std::memcpy(&k, s.data() + depth, 8);
+        return __builtin_bswap64(k);
+    }
+    std::uint64_t k = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+        k = (k << 8) | (depth + i < s.size() ? static_cast<unsigned char>(s[depth + i]) : 0u);
+    }
+    return k;
+}
+
+template <class T>
+void radix_sort_names(T* a, T* tmp, std::size_t n, std::size_t depth) {
+    if (n <= 32) {
+        std::sort(a, a + n, [](const T& x, const T& y) { return x.name < y.name; });
+        return;
+    }
+    std::uint32_t hist[8][256] = {};
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint64_t k = a[i].key = key_window(a[i].name, depth);
+        for (int b = 0; b < 8; ++b) ++hist[b][(k >> (8 * b)) & 0xff];
+    }
+    T* src = a;
+    T* dst = tmp;
+    for (int b = 0; b < 8; ++b) {
+        std::uint32_t* h = hist[b];
+        if (h[(src[0].key >> (8 * b)) & 0xff] == n) continue;   // all keys share this byte
+        std::uint32_t sum = 0;
+        for (int c = 0; c < 256; ++c) { std::uint32_t t = h[c]; h[c] = sum; sum += t; }
+        for (std::size_t i = 0; i < n; ++i) dst[h[(src[i].key >> (8 * b)) & 0xff]++] = src[i];
+        std::swap(src, dst);
+    }
+    if (src != a) std::copy(src, src + n, a);
+
+    // Names that agree on this window and continue past it
+    for (std::size_t i = 0; i < n;) {
+        std::size_t j = i + 1;
+        bool longer = a[i].name.size() > depth + 8;
+        while (j < n && a[j].key == a[i].key) longer |= a[j++].name.size() > depth + 8;
+        if (j - i > 1 && longer) radix_sort_names(a + i, tmp + i, j - i, depth + 8);
+        i = j;
+    }
+}
+
+}  // namespace format_detail
+
+template <class Result>
+void sort_by_name(std::vector<NamedResult<Result>>& v) {
+    std::vector<NamedResult<Result>> tmp(v.size());
+    format_detail::radix_sort_names(v.data(), tmp.data(), v.size(), 0);
+}
+
+// ---------- Result file ----------
+// The whole file is formatted into one buffer, sized up front from the name
+// lengths, and handed to the kernel with a single write.
+struct FormatOptions {
+    static constexpr int kMaxDecimals = 30;   // well past a double's 17 significant digits
+
+    int  decimals = 8;
+    bool sorted = false;      // lines in name order
+    bool canonical = false;   // 1BRC "{name=min/mean/max, ...}" (always sorted)
+};
+
+// --decimals: a whole number in [0, kMaxDecimals], nothing after it.
+inline bool parse_decimals(const char* s, int& out) {
+    char* end = nullptr;
+    errno = 0;
+    const long d = std::strtol(s, &end, 10);
+    if (end == s || *end != '\0' || errno == ERANGE || d < 0 || d > FormatOptions::kMaxDecimals) return false;
+    out = static_cast<int>(d);
+    return true;
+}
+
+class OutBuffer {
+public:
+    explicit OutBuffer(std::size_t cap) : buf_(cap) {}
+
+    // Room for at least n more bytes.
+    char* reserve(std::size_t n) {
+        if (len_ + n > buf_.size()) buf_.resize(std::max(buf_.size() * 2, len_ + n));
+        return buf_.data() + len_;
+    }
+    void commit(const char* end) { len_ = static_cast<std::size_t>(end - buf_.data()); }
+
+    bool write_file(const char* path) const {
+        int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) { std::perror("open"); return false; }
+        std::size_t done = 0;
+        while (done < len_) {
+            ssize_t w = ::write(fd, buf_.data() + done, len_ - done);
+            if (w <= 0) { std::perror("write"); ::close(fd); return false; }
+            done += static_cast<std::size_t>(w);
+        }
+        return ::close(fd) == 0;
+    }
+
+    std::string_view view() const { return {buf_.data(), len_}; }
+
+private:
+    std::vector<char> buf_;
+    std::size_t       len_ = 0;
+};
+
+// Columns a Result appends after max (ExtendedResult's stddev and quantiles).
+template <class Result>
+constexpr std::size_t extra_columns_of() {
+    if constexpr (requires { Result::kExtraColumns; }) return Result::kExtraColumns;
+    else return 0;
+}
+
+// `table` is anything with for_each(f(std::string_view, const Result&)) and
+// size(); Result needs min, max and mean(), and extra_columns(double*) if it
+// declares kExtraColumns. The canonical form never has extra columns.
+template <class Table>
+void format_results(const Table& table, const FormatOptions& fo, OutBuffer& out) {
+    using Result = typename Table::result_type;
+    constexpr std::size_t kExtra = extra_columns_of<Result>();
+    const std::size_t num = max_fixed_len(fo.decimals);
+
+    // "name;mean;min;max\n", or "name=min/mean/max" in canonical mode
+    auto emit = [&](std::string_view name, const Result& r, const char* lead, std::size_t lead_len) {
+        char* p = out.reserve(lead_len + name.size() + (3 + kExtra) * (num + 1));
+        std::memcpy(p, lead, lead_len);
+        p += lead_len;
+        std::memcpy(p, name.data(), name.size());
+        p += name.size();
+        // min/max skip NaN values, so a station that only had NaNs still
+        // holds the +/-inf starting values; it reports NaN, as its mean does.
+        const bool none = !(r.min <= r.max);
+        const double lo = none ? std::numeric_limits<double>::quiet_NaN() : r.min;
+        const double hi = none ? std::numeric_limits<double>::quiet_NaN() : r.max;
+        if (fo.canonical) {
+            *p++ = '=';
+            p = format_fixed(p, lo, fo.decimals);
+            *p++ = '/';
+            p = format_fixed(p, r.mean(), fo.decimals);
+            *p++ = '/';
+            p = format_fixed(p, hi, fo.decimals);
+        } else {
+            *p++ = ';';
+            p = format_fixed(p, r.mean(), fo.decimals);
+            *p++ = ';';
+            p = format_fixed(p, lo, fo.decimals);
+            *p++ = ';';
+            p = format_fixed(p, hi, fo.decimals);
+            if constexpr (kExtra != 0) {
+                double extra[kExtra];
+                r.extra_columns(extra);
+                for (double x : extra) {
+                    *p++ = ';';
+                    p = format_fixed(p, x, fo.decimals);
+                }
+            }
+            *p++ = '\n';
+        }
+        out.commit(p);
+    };
+
+    if (!fo.sorted && !fo.canonical) {
+        table.for_each([&](std::string_view name, const Result& r) { emit(name, r, "", 0); });
+        return;
+    }
+
+    std::vector<NamedResult<Result>> items;
+    items.reserve(table.size());
+    table.for_each([&](std::string_view name, const Result& r) { items.push_back({0, name, &r}); });
+    sort_by_name(items);
+
+    if (!fo.canonical) {
+        for (const auto& it : items) emit(it.name, *it.value, "", 0);
+        return;
+    }
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (i) emit(items[i].name, *items[i].value, ", ", 2);
+        else   emit(items[i].name, *items[i].value, "{", 1);
+    }
+    char* p = out.reserve(3);
+    if (items.empty()) *p++ = '{';
+    *p++ = '}';
+    *p++ = '\n';
+    out.commit(p);
+}
+
+template <class Table>
+bool write_results_file(const Table& table, const char* path, const FormatOptions& fo) {
+    std::size_t names = 0;
+    table.for_each([&](std::string_view name, const auto&) { names += name.size(); });
+    // Typical numbers are "-dd." plus the decimals; the slack covers the
+    // worst-case reserve of the last entry, so the buffer never regrows
+    OutBuffer out(names + table.size() * (3 * (fo.decimals + 6) + 4) + 3 * max_fixed_len(fo.decimals) + 64);
+    format_results(table, fo, out);
+    return out.write_file(path);
+}
@@ -0,0 +1,114 @@
+// gen_samples.cpp
+// Native replacement for create_test_samples.py: streams test_sample.txt and
+// test_sample_results_truth.txt to disk from all cores.
+//
+//   ./gen_samples [--rows 1B] [--stations 100] [--cities] [--name-len 3:24]
+//                 [--decimals N|full] [--range -10:50] [--order sorted|shuffled|zipf]
+//                 [--zipf-s 1.0] [--seed 42] [--threads N]
+//                 [--out test_sample.txt] [--truth test_sample_results_truth.txt]
+//
+// --cities uses the 100 station names of create_test_samples.py (so --stations
+// is capped at 100); otherwise names are random with uniform length in
+// --name-len. --decimals full (the default) prints every value at full
+// precision like the Python generator; --decimals 1 produces the classic
+// one-decimal format.
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include <sys/stat.h>
+
+#include "generate.hpp"
+
+static void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--rows N] [--stations N] [--cities] [--name-len MIN:MAX]\n"
+                 "          [--decimals N|full] [--range LO:HI] [--order sorted|shuffled|zipf]\n"
+                 "          [--zipf-s S] [--seed N] [--threads N] [--out PATH] [--truth PATH]\n",
+                 argv0);
+}
+
+// The whole token must be the number: "1x" or "abc" is an error, not 1 or 0.
+static bool parse_double(std::string_view s, double& out) {
+    const std::string t(s);
+    char* end = nullptr;
+    errno = 0;
+    const double v = std::strtod(t.c_str(), &end);
+    if (end == t.c_str() || *end != '\0' || errno == ERANGE) return false;
+    out = v;
+    return true;
+}
+
+// "A:B" -> a, b
+static bool parse_pair(std::string_view s, double& a, double& b) {
+    std::size_t colon = s.find(':');
+    if (colon == std::string_view::npos) return false;
+    return parse_double(s.substr(0, colon), a) && parse_double(s.substr(colon + 1), b);
+}
+
+static bool parse_args(int argc, char** argv, GenConfig& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a == "--cities") { cfg.city_names = true; continue; }
+        if (!v) return false;
+        ++i;
+        std::uint64_t n = 0;
+        if (a == "--rows") {
+            if (!parse_count(v, cfg.rows)) return false;
+        } else if (a == "--stations") {
+            if (!parse_count(v, n) || n > UINT32_MAX) return false;
+            cfg.stations = static_cast<std::uint32_t>(n);
+        } else if (a == "--name-len") {
+            double lo, hi;
+            if (!parse_pair(v, lo, hi) || lo < 1 || hi < lo || hi > 100) return false;
+            cfg.name_min = static_cast<std::uint32_t>(lo);
+            cfg.name_max = static_cast<std::uint32_t>(hi);
+        } else if (a == "--decimals") {
+            if (std::string_view(v) == "full") cfg.decimals = -1;
+            else if (parse_uint(v, 9, n)) cfg.decimals = static_cast<int>(n);
+            else return false;
+        } else if (a == "--range") {
+            if (!parse_pair(v, cfg.lo, cfg.hi)) return false;
+        } else if (a == "--order") {
+            std::string_view o = v;
+            if (o == "sorted") cfg.order = RowOrder::Sorted;
+            else if (o == "shuffled") cfg.order = RowOrder::Shuffled;
+            else if (o == "zipf") cfg.order = RowOrder::Zipf;
+            else return false;
+        } else if (a == "--zipf-s") {
+            if (!parse_double(v, cfg.zipf_s)) return false;
+        } else if (a == "--seed") {
+            if (!parse_uint(v, UINT64_MAX, n)) return false;
+            cfg.seed = n;
+        } else if (a == "--threads") {
+            if (!parse_uint(v, 4096, n)) return false;
+            cfg.threads = static_cast<unsigned>(n);
+        } else if (a == "--out") cfg.out = v;
+        else if (a == "--truth") cfg.truth = v;
+        else return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    GenConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (!generate_samples(cfg)) return 1;
+    auto t1 = std::chrono::steady_clock::now();
+
+    struct stat sb;
+    const double bytes = ::stat(cfg.out.c_str(), &sb) == 0 ? static_cast<double>(sb.st_size) : 0.0;
+    const double secs = std::chrono::duration<double>(t1 - t0).count();
+    std::fprintf(stderr, "gen: %llu rows, %.2f GB in %.2f s (%.2f GB/s)\n",
+                 static_cast<unsigned long long>(cfg.rows), bytes / 1e9, secs, bytes / secs / 1e9);
+    return 0;
+}
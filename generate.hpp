@@ -0,0 +1,310 @@
+// generate.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// ---------- Measurement file generator ----------
+// Streams `city;value\n` rows straight to disk from several threads and
+// computes the truth file in the same pass. Rows are cut into fixed batches;
+// batch i is generated from its own seed (seed, i), so the output is the same
+// for any thread count, and batches are written strictly in order.
+
+// The station list create_test_samples.py uses.
+inline const char* const kCities[] = {
+    "New York", "Los Angeles", "Chicago", "Houston", "Phoenix", "London", "Manchester",
+    "Birmingham", "Liverpool", "Edinburgh", "Paris", "Marseille", "Lyon", "Toulouse", "Nice",
+    "Berlin", "Munich", "Frankfurt", "Hamburg", "Cologne", "Rome", "Milan", "Naples", "Turin",
+    "Florence", "Madrid", "Barcelona", "Valencia", "Seville", "Bilbao", "Lisbon", "Porto", "Braga",
+    "Faro", "Coimbra", "Tokyo", "Osaka", "Kyoto", "Nagoya", "Fukuoka", "Beijing", "Shanghai",
+    "Shenzhen", "Guangzhou", "Chengdu", "Seoul", "Busan", "Incheon", "Daegu", "Daejeon", "Mumbai",
+    "Delhi", "Bangalore", "Hyderabad", "Chennai", "Cairo", "Alexandria", "Giza", "Luxor", "Aswan",
+    "Johannesburg", "Cape Town", "Durban", "Pretoria", "Port Elizabeth", "Sydney", "Melbourne",
+    "Brisbane", "Perth", "Adelaide", "Toronto", "Vancouver", "Montreal", "Calgary", "Ottawa",
+    "Mexico City", "Guadalajara", "Monterrey", "Puebla", "Cancún", "Buenos Aires", "Córdoba",
+    "Rosario", "Mendoza", "La Plata", "São Paulo", "Rio de Janeiro", "Brasília", "Salvador",
+    "Recife", "Moscow", "Saint Petersburg", "Novosibirsk", "Yekaterinburg", "Kazan", "Istanbul",
+    "Ankara", "Izmir", "Antalya", "Bursa",
+};
+
+enum class RowOrder { Sorted, Shuffled, Zipf };
+
+struct GenConfig {
+    std::uint64_t rows = 100'000'000;
+    std::uint32_t stations = 100;
+    bool          city_names = false;   // use kCities instead of random names
+    std::uint32_t name_min = 3;         // random name length, uniform in [name_min, name_max]
+    std::uint32_t name_max = 24;
+    int           decimals = -1;        // -1: full precision (shortest round-trip, like repr)
+    double        lo = -10.0;
+    double        hi = 50.0;
+    RowOrder      order = RowOrder::Sorted;
+    double        zipf_s = 1.0;
+    std::uint64_t seed = 42;
+    unsigned      threads = 0;          // 0: hardware_concurrency
+    std::string   out = "test_sample.txt";
+    std::string   truth = "test_sample_results_truth.txt";
+};
+
+// Per-station truth. Sums are exact: fixed-decimal values are summed as
+// integer units, full-precision values as 128-bit fixed point at 2^-80 (exact
+// for |v| >= 2^-28, which is every value but a vanishing few near zero).
+struct TruthStats {
+    double        min = INFINITY;
+    double        max = -INFINITY;
+    std::uint64_t count = 0;
+    __int128      sum = 0;
+
+    void merge(const TruthStats& o) {
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+        count += o.count;
+        sum += o.sum;
+    }
+};
+
+namespace gen_detail {
+
+constexpr int kFracBits = 80;
+
+inline std::uint64_t mix(std::uint64_t a, std::uint64_t b) {
+    std::uint64_t z = a * 0x9E3779B97F4A7C15ull + b + 0x632BE59BD9B4E019ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+inline std::vector<std::string> make_names(const GenConfig& cfg) {
+    std::vector<std::string> names;
+    names.reserve(cfg.stations);
+    if (cfg.city_names) {
+        for (std::uint32_t i = 0; i < cfg.stations; ++i) names.emplace_back(kCities[i]);
+        return names;
+    }
+    // Random letters plus a base-26 index suffix wide enough for every
+    // station, which keeps names unique without a set lookup per name.
+    std::uint32_t width = 1;
+    for (std::uint64_t cap = 26; cap < cfg.stations; cap *= 26) ++width;
+    std::mt19937_64 rng(mix(cfg.seed, 0));  // batches use (seed, b + 1)
+    std::uniform_int_distribution<std::uint32_t> len(cfg.name_min, std::max(cfg.name_min, cfg.name_max));
+    std::uniform_int_distribution<int> ch('a', 'z');
+    for (std::uint32_t i = 0; i < cfg.stations; ++i) {
+        std::string s(std::max(len(rng), width), ' ');
+        const std::size_t head = s.size() - width;
+        for (std::size_t k = 0; k < head; ++k) s[k] = static_cast<char>(ch(rng));
+        for (std::uint32_t k = 0, x = i; k < width; ++k, x /= 26) s[s.size() - 1 - k] = static_cast<char>('a' + x % 26);
+        s[0] = static_cast<char>(s[0] - 'a' + 'A');
+        names.push_back(std::move(s));
+    }
+    return names;
+}
+
+// Vose alias table: O(1) draws from a Zipf(s) distribution over stations.
+struct AliasTable {
+    std::vector<double>        prob;
+    std::vector<std::uint32_t> alias;
+
+    void build(std::uint32_t n, double s) {
+        std::vector<double> w(n);
+        double total = 0.0;
+        for (std::uint32_t i = 0; i < n; ++i) total += w[i] = 1.0 / std::pow(i + 1.0, s);
+        prob.resize(n);
+        alias.resize(n);
+        std::vector<std::uint32_t> small, large;
+        for (std::uint32_t i = 0; i < n; ++i) {
+            w[i] = w[i] * n / total;
+            (w[i] < 1.0 ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty()) {
+            std::uint32_t a = small.back(), b = large.back();
+            small.pop_back();
+            prob[a] = w[a];
+            alias[a] = b;
+            w[b] -= 1.0 - w[a];
+            if (w[b] < 1.0) { large.pop_back(); small.push_back(b); }
+        }
+        for (std::uint32_t i : large) prob[i] = 1.0;
+        for (std::uint32_t i : small) prob[i] = 1.0;
+    }
+
+    std::uint32_t draw(std::mt19937_64& rng) const {
+        std::uint32_t i = static_cast<std::uint32_t>(rng() % prob.size());
+        return std::generate_canonical<double, 53>(rng) < prob[i] ? i : alias[i];
+    }
+};
+
+inline void print_truth_line(FILE* fp, const std::string& name, const TruthStats& t, int decimals) {
+    long double mean;
+    if (decimals >= 0) {
+        mean = static_cast<long double>(t.sum) / std::pow(10.0L, decimals) / static_cast<long double>(t.count);
+    } else {
+        mean = std::ldexp(static_cast<long double>(t.sum), -kFracBits) / static_cast<long double>(t.count);
+    }
+    std::fprintf(fp, "%s;%.17g;%.17g;%.17g\n", name.c_str(), static_cast<double>(mean), t.min, t.max);
+}
+
+}  // namespace gen_detail
+
+// Decimal digits only, all of tok, at most max.
+inline bool parse_uint(std::string_view tok, std::uint64_t max, std::uint64_t& out) {
+    std::uint64_t v = 0;
+    const auto [end, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), v);
+    if (ec != std::errc() || end != tok.data() + tok.size() || v > max) return false;
+    out = v;
+    return true;
+}
+
+// "250", "10k", "1M", "1B" -> count; false on anything else or on overflow
+inline bool parse_count(std::string_view tok, std::uint64_t& out) {
+    std::uint64_t mult = 1;
+    if (!tok.empty()) {
+        switch (tok.back()) {
+            case 'k': case 'K': mult = 1000; break;
+            case 'm': case 'M': mult = 1000000; break;
+            case 'b': case 'B': case 'g': case 'G': mult = 1000000000; break;
+        }
+        if (mult != 1) tok.remove_suffix(1);
+    }
+    std::uint64_t v = 0;
+    if (!parse_uint(tok, UINT64_MAX / mult, v)) return false;
+    out = v * mult;
+    return true;
+}
+
+inline bool generate_samples(const GenConfig& cfg) {
+    using namespace gen_detail;
+    if (cfg.stations == 0 || (cfg.city_names && cfg.stations > sizeof kCities / sizeof kCities[0])) {
+        std::fprintf(stderr, "generate: bad station count %u\n", cfg.stations);
+        return false;
+    }
+    if (!(cfg.lo < cfg.hi) || std::max(std::fabs(cfg.lo), std::fabs(cfg.hi)) >= 0x1p40) {
+        std::fprintf(stderr, "generate: value range must satisfy lo < hi and |v| < 2^40\n");
+        return false;
+    }
+    const std::vector<std::string> names = make_names(cfg);
+    AliasTable zipf;
+    if (cfg.order == RowOrder::Zipf) zipf.build(cfg.stations, cfg.zipf_s);
+
+    int fd = ::open(cfg.out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { std::perror(cfg.out.c_str()); return false; }
+
+    constexpr std::uint64_t kBatchRows = 1 << 18;
+    const std::uint64_t n_batches = (cfg.rows + kBatchRows - 1) / kBatchRows;
+    unsigned n_threads = cfg.threads ? cfg.threads : std::thread::hardware_concurrency();
+    if (n_threads == 0) n_threads = 1;
+    n_threads = static_cast<unsigned>(std::min<std::uint64_t>(n_threads, std::max<std::uint64_t>(n_batches, 1)));
+
+    const double scale = cfg.decimals >= 0 ? std::pow(10.0, cfg.decimals) : 1.0;
+    const std::int64_t unit_lo = static_cast<std::int64_t>(std::ceil(cfg.lo * scale));
+    const std::int64_t unit_hi = static_cast<std::int64_t>(std::floor(cfg.hi * scale));
+
+    std::vector<std::vector<TruthStats>> truth(n_threads, std::vector<TruthStats>(cfg.stations));
+    std::atomic<std::uint64_t> next_batch{0};
+    std::uint64_t next_write = 0;
+    std::mutex mu;
+    std::condition_variable cv;
+    std::atomic<bool> failed{false};
+
+    auto worker = [&](unsigned t) {
+        std::vector<char> buf;
+        std::vector<TruthStats>& mine = truth[t];
+        for (;;) {
+            const std::uint64_t b = next_batch.fetch_add(1);
+            if (b >= n_batches || failed) return;
+            const std::uint64_t r0 = b * kBatchRows;
+            const std::uint64_t r1 = std::min(cfg.rows, r0 + kBatchRows);
+            std::mt19937_64 rng(mix(cfg.seed, b + 1));
+            std::uniform_real_distribution<double> real(cfg.lo, cfg.hi);
+            std::uniform_int_distribution<std::int64_t> units(unit_lo, unit_hi);
+            std::uniform_int_distribution<std::uint32_t> uni(0, cfg.stations - 1);
+
+            buf.clear();
+            char line[160];
+            for (std::uint64_t r = r0; r < r1; ++r) {
+                std::uint32_t s;
+                switch (cfg.order) {
+                    case RowOrder::Sorted:   s = static_cast<std::uint32_t>(static_cast<unsigned __int128>(r) * cfg.stations / cfg.rows); break;
+                    case RowOrder::Shuffled: s = uni(rng); break;
+                    default:                 s = zipf.draw(rng); break;
+                }
+                const std::string& name = names[s];
+                std::memcpy(line, name.data(), name.size());
+                char* p = line + name.size();
+                *p++ = ';';
+
+                double v;
+                TruthStats& ts = mine[s];
+                if (cfg.decimals >= 0) {
+                    const std::int64_t u = units(rng);
+                    v = static_cast<double>(u) / scale;
+                    ts.sum += u;
+                    // Fixed-decimal text from the integer, so it matches `u` exactly
+                    std::uint64_t mag = static_cast<std::uint64_t>(u < 0 ? -u : u);
+                    if (u < 0) *p++ = '-';
+                    const std::uint64_t div = static_cast<std::uint64_t>(scale);
+                    p = std::to_chars(p, line + sizeof line, mag / div).ptr;
+                    if (cfg.decimals > 0) {
+                        *p++ = '.';
+                        std::uint64_t frac = mag % div;
+                        for (int k = cfg.decimals - 1; k >= 0; --k, frac /= 10) p[k] = static_cast<char>('0' + frac % 10);
+                        p += cfg.decimals;
+                    }
+                } else {
+                    v = real(rng);
+                    ts.sum += static_cast<__int128>(std::ldexp(v, kFracBits));
+                    p = std::to_chars(p, line + sizeof line, v).ptr;
+                }
+                *p++ = '\n';
+                if (v < ts.min) ts.min = v;
+                if (v > ts.max) ts.max = v;
+                ++ts.count;
+                buf.insert(buf.end(), line, p);
+            }
+
+            // Write in batch order; everyone else keeps generating meanwhile
+            std::unique_lock<std::mutex> lk(mu);
+            cv.wait(lk, [&] { return next_write == b || failed; });
+            if (failed) return;
+            lk.unlock();
+            std::size_t done = 0;
+            while (done < buf.size()) {
+                ssize_t w = ::write(fd, buf.data() + done, buf.size() - done);
+                if (w <= 0) { std::perror("write"); failed = true; break; }
+                done += static_cast<std::size_t>(w);
+            }
+            lk.lock();
+            ++next_write;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < n_threads; ++t) pool.emplace_back(worker, t);
+    for (auto& th : pool) th.join();
+    if (::close(fd) != 0 || failed) return false;
+
+    for (unsigned t = 1; t < n_threads; ++t) {
+        for (std::uint32_t s = 0; s < cfg.stations; ++s) truth[0][s].merge(truth[t][s]);
+    }
+
+    FILE* fp = std::fopen(cfg.truth.c_str(), "w");
+    if (!fp) { std::perror(cfg.truth.c_str()); return false; }
+    for (std::uint32_t s = 0; s < cfg.stations; ++s) {
+        if (truth[0][s].count) print_truth_line(fp, names[s], truth[0][s], cfg.decimals);
+    }
+    return std::fclose(fp) == 0;
+}
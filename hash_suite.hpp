@@ -0,0 +1,255 @@
+// hash_suite.hpp
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "city_result.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define BRC_HASH_X86 1
+#endif
+
+// ---------- Station hash policies ----------
+// Drop-in Hash parameters for StationTable (and the unordered_map baselines):
+//   SvHash         byte-at-a-time FNV-1a (city_result.hpp), the reference
+//   WordHash       the key as 8-byte words, one 64x64->128 multiply per 16 bytes
+//   Crc32cHash     the same words through two CRC32C lanes (SSE4.2)
+//   AesHash        the same words through two AES rounds (AES-NI)
+// The last three see a key as blocks of 16 bytes: the first block is the
+// first 16 bytes zero-padded, longer keys add one block per further 16 bytes
+// (the last one overlapping the end). Because that first block is just two
+// masked little-endian loads, a caller that may read past the key can build it
+// without any byte loop (hash_bounded), or find the ';' inside those same two
+// words while loading them (hash_scan). Crc32cHash and AesHash check the CPU
+// once at startup and fall back to WordHash without the instructions.
+//
+// The table rehashes the hash with a multiplicative mix before taking the top
+// bits, so a policy only has to keep distinct keys apart, not spread them.
+
+namespace hash_detail {
+
+inline std::uint64_t load8(const char* p) noexcept {
+    std::uint64_t w;
+    std::memcpy(&w, p, 8);
+    return w;
+}
+
+inline std::uint32_t load4(const char* p) noexcept {
+    std::uint32_t w;
+    std::memcpy(&w, p, 4);
+    return w;
+}
+
+// Low k bytes of w (k in [0, 8]).
+inline std::uint64_t low_bytes(std::uint64_t w, std::size_t k) noexcept {
+    return k >= 8 ? w : w & ((std::uint64_t{1} << (8 * k)) - 1);
+}
+
+// The first 16 bytes of [p, p+len), zero-padded, without reading past p+len.
+inline void first_block(const char* p, std::size_t len, std::uint64_t& w0, std::uint64_t& w1) noexcept {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    if (len >= 16) {
+        w0 = load8(p);
+        w1 = load8(p + 8);
+    } else if (len >= 8) {
+        w0 = load8(p);
+        w1 = len > 8 ? load8(p + len - 8) >> (8 * (16 - len)) : 0;
+    } else if (len >= 4) {
+        w0 = load4(p) | static_cast<std::uint64_t>(load4(p + len - 4)) << (8 * (len - 4));
+        w1 = 0;
+    } else if (len) {
+        w0 = u[0] | static_cast<std::uint64_t>(u[len / 2]) << (8 * (len / 2))
+                  | static_cast<std::uint64_t>(u[len - 1]) << (8 * (len - 1));
+        w1 = 0;
+    } else {
+        w0 = w1 = 0;
+    }
+}
+
+// Further blocks of a key longer than 16 bytes: offsets 16, 32, ..., the
+// last one pulled back to end at len.
+inline std::size_t tail_block(std::size_t off, std::size_t len) noexcept {
+    return off + 16 <= len ? off : len - 16;
+}
+
+inline std::uint64_t fold_mul(std::uint64_t a, std::uint64_t b) noexcept {
+    const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+}
+
+constexpr std::uint64_t kSeed0 = 0xa0761d6478bd642full;
+constexpr std::uint64_t kSeed1 = 0xe7037ed1a0b428dbull;
+constexpr std::uint64_t kSeed2 = 0x8ebc6af09c88c6e3ull;
+
+#ifdef BRC_HASH_X86
+inline const bool kHaveCrc32c = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}();
+inline const bool kHaveAes = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse4.2");
+}();
+#endif
+
+}  // namespace hash_detail
+
+struct WordHash {
+    using is_transparent = void;
+    static constexpr const char* kName = "word";
+
+    static std::uint64_t words(std::uint64_t w0, std::uint64_t w1, const char* p, std::size_t len) noexcept {
+        using namespace hash_detail;
+        std::uint64_t h = fold_mul(w0 ^ kSeed0, w1 ^ kSeed1 ^ len);
+        for (std::size_t off = 16; off < len; off += 16) {
+            const std::size_t o = tail_block(off, len);
+            h = fold_mul(load8(p + o) ^ h, load8(p + o + 8) ^ kSeed2);
+        }
+        return h;
+    }
+
+    std::size_t operator()(std::string_view s) const noexcept {
+        std::uint64_t w0, w1;
+        hash_detail::first_block(s.data(), s.size(), w0, w1);
+        return static_cast<std::size_t>(words(w0, w1, s.data(), s.size()));
+    }
+};
+
+#ifdef BRC_HASH_X86
+namespace hash_detail {
+
+__attribute__((target("sse4.2")))
+inline std::uint64_t crc32c_words(std::uint64_t w0, std::uint64_t w1, const char* p, std::size_t len) noexcept {
+    std::uint64_t a = _mm_crc32_u64(static_cast<std::uint32_t>(kSeed0 ^ len), w0);
+    std::uint64_t b = _mm_crc32_u64(static_cast<std::uint32_t>(kSeed1), w1);
+    a = _mm_crc32_u64(a, w1);
+    b = _mm_crc32_u64(b, w0);
+    for (std::size_t off = 16; off < len; off += 16) {   // no lambda: it would not inherit the target
+        const std::size_t o = tail_block(off, len);
+        const std::uint64_t x = load8(p + o), y = load8(p + o + 8);
+        a = _mm_crc32_u64(_mm_crc32_u64(a, x), y);
+        b = _mm_crc32_u64(_mm_crc32_u64(b, y), x);
+    }
+    return a << 32 | b;
+}
+
+__attribute__((target("aes,sse4.2")))
+inline std::uint64_t aes_words(std::uint64_t w0, std::uint64_t w1, const char* p, std::size_t len) noexcept {
+    const __m128i key = _mm_set_epi64x(static_cast<long long>(kSeed1), static_cast<long long>(kSeed0 ^ len));
+    __m128i s = _mm_aesenc_si128(_mm_xor_si128(_mm_set_epi64x(static_cast<long long>(w1), static_cast<long long>(w0)), key), key);
+    for (std::size_t off = 16; off < len; off += 16) {
+        const __m128i blk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + tail_block(off, len)));
+        s = _mm_aesenc_si128(_mm_xor_si128(s, blk), key);
+    }
+    s = _mm_aesenc_si128(s, key);
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si64(s)) ^ static_cast<std::uint64_t>(_mm_extract_epi64(s, 1));
+}
+
+}  // namespace hash_detail
+#endif
+
+struct Crc32cHash {
+    using is_transparent = void;
+    static constexpr const char* kName = "crc32c";
+
+    static std::uint64_t words(std::uint64_t w0, std::uint64_t w1, const char* p, std::size_t len) noexcept {
+#ifdef BRC_HASH_X86
+        if (hash_detail::kHaveCrc32c) return hash_detail::crc32c_words(w0, w1, p, len);
+#endif
+        return WordHash::words(w0, w1, p, len);
+    }
+
+    std::size_t operator()(std::string_view s) const noexcept {
+        std::uint64_t w0, w1;
+        hash_detail::first_block(s.data(), s.size(), w0, w1);
+        return static_cast<std::size_t>(words(w0, w1, s.data(), s.size()));
+    }
+};
+
+struct AesHash {
+    using is_transparent = void;
+    static constexpr const char* kName = "aes";
+
+    static std::uint64_t words(std::uint64_t w0, std::uint64_t w1, const char* p, std::size_t len) noexcept {
+#ifdef BRC_HASH_X86
+        if (hash_detail::kHaveAes) return hash_detail::aes_words(w0, w1, p, len);
+#endif
+        return WordHash::words(w0, w1, p, len);
+    }
+
+    std::size_t operator()(std::string_view s) const noexcept {
+        std::uint64_t w0, w1;
+        hash_detail::first_block(s.data(), s.size(), w0, w1);
+        return static_cast<std::size_t>(words(w0, w1, s.data(), s.size()));
+    }
+};
+
+// Policy used by the solution; override at build time, e.g. -DBRC_HASH=AesHash.
+#ifndef BRC_HASH
+#define BRC_HASH WordHash
+#endif
+using DefaultHash = BRC_HASH;
+
+template <class Hash>
+concept BlockHash = requires(std::uint64_t w, const char* p, std::size_t n) {
+    { Hash::words(w, w, p, n) } -> std::same_as<std::uint64_t>;
+};
+
+template <class Hash>
+constexpr const char* hash_name() {
+    if constexpr (requires { Hash::kName; }) return Hash::kName;
+    else return "fnv1a";
+}
+
+// ---------- Hashing straight from the input buffer ----------
+// Same value as Hash{}(key) for key = [p, p+len). When 16 bytes from p are
+// readable (p + 16 <= limit), block hashes take their first block from two
+// plain loads instead of assembling it.
+template <class Hash>
+inline std::uint64_t hash_bounded(const char* p, std::size_t len, const char* limit) noexcept {
+    if constexpr (BlockHash<Hash>) {
+        if (p + 16 <= limit) {
+            using namespace hash_detail;
+            const std::uint64_t w0 = low_bytes(load8(p), len);
+            const std::uint64_t w1 = len > 8 ? low_bytes(load8(p + 8), len - 8) : 0;
+            return Hash::words(w0, w1, p, len);
+        }
+    }
+    return static_cast<std::uint64_t>(Hash{}(std::string_view(p, len)));
+}
+
+// Finds the first ';' in [p, limit) and hashes the key before it; sep is set
+// to the ';' (nullptr, and 0 returned, if there is none). For keys under 16
+// bytes the two words that are searched are the ones hashed.
+template <class Hash>
+inline std::uint64_t hash_scan(const char* p, const char* limit, const char*& sep) noexcept {
+    if constexpr (BlockHash<Hash>) {
+        if (p + 16 <= limit) {
+            using namespace hash_detail;
+            constexpr std::uint64_t kOnes = 0x0101010101010101ull, kSemi = kOnes * ';';
+            auto first_semi = [](std::uint64_t w) {   // SWAR zero-byte test on w ^ ";;;;;;;;"
+                const std::uint64_t x = w ^ kSemi;
+                return (x - kOnes) & ~x & (kOnes * 0x80);
+            };
+            const std::uint64_t w0 = load8(p), w1 = load8(p + 8);
+            if (const std::uint64_t m = first_semi(w0)) {
+                const std::size_t k = static_cast<std::size_t>(__builtin_ctzll(m)) / 8;
+                sep = p + k;
+                return Hash::words(low_bytes(w0, k), 0, p, k);
+            }
+            if (const std::uint64_t m = first_semi(w1)) {
+                const std::size_t k = 8 + static_cast<std::size_t>(__builtin_ctzll(m)) / 8;
+                sep = p + k;
+                return Hash::words(w0, low_bytes(w1, k - 8), p, k);
+            }
+            sep = static_cast<const char*>(std::memchr(p + 16, ';', static_cast<std::size_t>(limit - p - 16)));
+            return sep ? Hash::words(w0, w1, p, static_cast<std::size_t>(sep - p)) : 0;
+        }
+    }
+    sep = static_cast<const char*>(std::memchr(p, ';', static_cast<std::size_t>(limit - p)));
+    return sep ? static_cast<std::uint64_t>(Hash{}(std::string_view(p, static_cast<std::size_t>(sep - p)))) : 0;
+}
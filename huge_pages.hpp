@@ -0,0 +1,113 @@
+// huge_pages.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+// ---------- 2 MiB huge-page arena ----------
+// Large station tables are sparse, randomly probed arrays: with 4 KiB pages a
+// 1M-station table spans 32k pages and most probes miss the TLB. When
+// enabled, allocations of at least 2 MiB come from anonymous mappings rounded
+// to whole 2 MiB pages: explicit hugetlbfs pages (MAP_HUGETLB) if the system
+// has some reserved, otherwise transparent huge pages via MADV_HUGEPAGE.
+// Smaller allocations and the disabled case use the regular heap.
+
+class HugePageArena {
+public:
+    static constexpr std::size_t kHuge = 2 << 20;
+
+    static HugePageArena& instance() {
+        static HugePageArena a;
+        return a;
+    }
+
+    void enable(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // nullptr when disabled, too small, or the mapping fails.
+    void* allocate(std::size_t bytes) {
+        if (!enabled() || bytes < kHuge) return nullptr;
+        const std::size_t len = (bytes + kHuge - 1) / kHuge * kHuge;
+        bool hugetlb = true;
+        void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (p == MAP_FAILED) {
+            hugetlb = false;
+            p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) return nullptr;
+#ifdef MADV_HUGEPAGE
+            ::madvise(p, len, MADV_HUGEPAGE);
+#endif
+        }
+        std::lock_guard<std::mutex> lk(mu_);
+        blocks_.push_back({p, len});
+        live_.fetch_add(1, std::memory_order_relaxed);
+        (hugetlb ? hugetlb_bytes_ : thp_bytes_) += len;
+        return p;
+    }
+
+    // True if p, allocated with `bytes`, came from the arena (and is now
+    // unmapped). A block too small for the arena, or no block out at all,
+    // is answered without the lock.
+    bool release(void* p, std::size_t bytes) {
+        if (bytes < kHuge || live_.load(std::memory_order_relaxed) == 0) return false;
+        std::lock_guard<std::mutex> lk(mu_);
+        auto it = std::find_if(blocks_.begin(), blocks_.end(), [&](const Block& b) { return b.ptr == p; });
+        if (it == blocks_.end()) return false;
+        ::munmap(it->ptr, it->len);
+        *it = blocks_.back();
+        blocks_.pop_back();
+        live_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Bytes handed out so far from hugetlbfs and from THP-advised mappings.
+    std::pair<std::size_t, std::size_t> totals() {
+        std::lock_guard<std::mutex> lk(mu_);
+        return {hugetlb_bytes_, thp_bytes_};
+    }
+
+private:
+    struct Block {
+        void*       ptr;
+        std::size_t len;
+    };
+
+    std::atomic<bool>        enabled_{false};
+    std::atomic<std::size_t> live_{0};   // blocks_.size(), readable without mu_
+    std::mutex               mu_;
+    std::vector<Block>       blocks_;
+    std::size_t              hugetlb_bytes_ = 0;
+    std::size_t              thp_bytes_ = 0;
+};
+
+// std::allocator replacement that routes big blocks through the arena.
+template <class T>
+struct HugePageAllocator {
+    using value_type = T;
+
+    HugePageAllocator() = default;
+    template <class U>
+    HugePageAllocator(const HugePageAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        const std::size_t bytes = n * sizeof(T);
+        if (void* p = HugePageArena::instance().allocate(bytes)) return static_cast<T*>(p);
+        return static_cast<T*>(::operator new(bytes, std::align_val_t{alignof(T)}));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        if (!HugePageArena::instance().release(p, n * sizeof(T))) ::operator delete(p, std::align_val_t{alignof(T)});
+    }
+
+    template <class U>
+    bool operator==(const HugePageAllocator<U>&) const noexcept { return true; }
+};
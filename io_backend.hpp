@@ -0,0 +1,449 @@
+// io_backend.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define BRC_URING 1
+#endif
+
+// ---------- Streaming read backends ----------
+// The mmap path lets the kernel fault pages in on demand, which on inputs
+// larger than RAM means synchronous faults and a thrashed page cache. The
+// streaming backends instead read the range [begin, end) into a ring of
+// fixed-size, 4 KiB-aligned chunk buffers ahead of the parser:
+//
+//   stdio  one reader thread, fread through a 1 MiB stdio buffer
+//   pread  a small pool of reader threads, one pread per chunk
+//   uring  one thread keeping up to kUringDepth reads in flight via io_uring
+//          (raw syscalls, no liburing); falls back to pread if unavailable
+//
+// pread and uring can open the file with O_DIRECT to bypass the page cache
+// (falling back to buffered reads where the filesystem refuses it). Chunk c
+// lives in slot c % slots; the reader may run up to `slots` chunks ahead of
+// the slowest consumer, so with two slots per worker every parser has one
+// chunk to work on and one in flight.
+
+enum class IoBackend { Mmap, Stdio, Pread, Uring };
+
+inline const char* io_backend_name(IoBackend b) {
+    switch (b) {
+        case IoBackend::Mmap:  return "mmap";
+        case IoBackend::Stdio: return "stdio";
+        case IoBackend::Pread: return "pread";
+        default:               return "uring";
+    }
+}
+
+inline bool parse_io_backend(std::string_view s, IoBackend& out) {
+    for (IoBackend b : {IoBackend::Mmap, IoBackend::Stdio, IoBackend::Pread, IoBackend::Uring}) {
+        if (s == io_backend_name(b)) { out = b; return true; }
+    }
+    return false;
+}
+
+struct IoStats {
+    IoBackend     backend = IoBackend::Mmap;   // the one actually used
+    bool          direct = false;
+    std::uint64_t bytes = 0;
+    std::uint64_t reads = 0;                   // read calls / SQEs issued
+    double        seconds = 0.0;               // first read to last chunk loaded
+
+    void report(FILE* fp) const {
+        std::fprintf(fp, "io: %s%s, %.2f GB in %.3f s (%.2f GB/s), %llu reads\n",
+                     io_backend_name(backend), direct ? " O_DIRECT" : "", static_cast<double>(bytes) / 1e9,
+                     seconds, seconds > 0 ? static_cast<double>(bytes) / seconds / 1e9 : 0.0,
+                     static_cast<unsigned long long>(reads));
+    }
+};
+
+#if BRC_URING
+// Minimal io_uring: one submission and one completion ring, mapped by hand.
+class Uring {
+public:
+    bool init(unsigned entries) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof p);
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if (fd_ < 0) return false;
+
+        sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+
+        sq_map_ = ::mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if (sq_map_ == MAP_FAILED) { sq_map_ = nullptr; return false; }
+        cq_map_ = single ? sq_map_
+                         : ::mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cq_map_ == MAP_FAILED) { cq_map_ = nullptr; return false; }
+        sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_map_);
+        char* cq = static_cast<char*>(cq_map_);
+        sq_tail_  = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask_  = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        cq_head_  = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_  = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_  = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_     = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    ~Uring() {
+        if (sqes_) ::munmap(sqes_, sqes_len_);
+        if (cq_map_ && cq_map_ != sq_map_) ::munmap(cq_map_, cq_len_);
+        if (sq_map_) ::munmap(sq_map_, sq_len_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    // Queues a readv; `iov` must stay valid until its completion is reaped.
+    void queue_readv(int fd, const iovec* iov, std::uint64_t off, std::uint64_t user) {
+        const unsigned tail = *sq_tail_;
+        const unsigned idx = tail & sq_mask_;
+        io_uring_sqe* e = &sqes_[idx];
+        std::memset(e, 0, sizeof *e);
+        e->opcode = IORING_OP_READV;
+        e->fd = fd;
+        e->addr = reinterpret_cast<std::uint64_t>(iov);
+        e->len = 1;
+        e->off = off;
+        e->user_data = user;
+        sq_array_[idx] = idx;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        ++queued_;
+    }
+
+    // Submits everything queued and waits for at least `wait` completions.
+    bool submit(unsigned wait) {
+        for (;;) {
+            long r = ::syscall(__NR_io_uring_enter, fd_, queued_, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (r >= 0) { queued_ -= static_cast<unsigned>(r); return true; }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+        }
+    }
+
+    bool pop(io_uring_cqe& out) {
+        const unsigned head = *cq_head_;
+        if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) return false;
+        out = cqes_[head & cq_mask_];
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    int           fd_ = -1;
+    void*         sq_map_ = nullptr;
+    void*         cq_map_ = nullptr;
+    std::size_t   sq_len_ = 0, cq_len_ = 0, sqes_len_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned*     sq_tail_ = nullptr;
+    unsigned*     sq_array_ = nullptr;
+    unsigned      sq_mask_ = 0;
+    unsigned*     cq_head_ = nullptr;
+    unsigned*     cq_tail_ = nullptr;
+    unsigned      cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned      queued_ = 0;
+};
+#endif
+
+class ChunkPipeline {
+public:
+    static constexpr std::size_t kAlign = 4096;
+    static constexpr std::size_t kChunk = 4 << 20;
+    static constexpr unsigned    kPreadThreads = 4;
+    static constexpr unsigned    kUringDepth = 16;
+
+    ChunkPipeline() = default;
+    ChunkPipeline(const ChunkPipeline&) = delete;
+    ChunkPipeline& operator=(const ChunkPipeline&) = delete;
+    ~ChunkPipeline() { finish(); }
+
+    // Starts reading [begin, end) of path. `slots` chunk buffers are allocated.
+    bool start(const char* path, IoBackend backend, std::uint64_t begin, std::uint64_t end,
+               unsigned slots, bool direct) {
+        begin_ = begin;
+        end_ = end;
+        base_ = begin / kAlign * kAlign;
+        n_chunks_ = end > base_ ? (end - base_ + kChunk - 1) / kChunk : 0;
+        stats_ = IoStats{};
+        stats_.backend = backend;
+        failed_ = false;
+        done_ = next_pread_ = 0;
+        reads_ = 0;
+
+        const bool want_direct = direct && backend != IoBackend::Stdio;
+        fd_ = -1;
+#ifdef O_DIRECT
+        if (want_direct) {
+            fd_ = ::open(path, O_RDONLY | O_DIRECT);
+            if (fd_ < 0) std::fprintf(stderr, "io: O_DIRECT unavailable here, using buffered reads\n");
+        }
+#endif
+        stats_.direct = fd_ >= 0;
+        if (fd_ < 0) fd_ = ::open(path, O_RDONLY);
+        if (fd_ < 0) { std::perror("open"); return false; }
+        if (!stats_.direct) ::posix_fadvise(fd_, static_cast<off_t>(begin), static_cast<off_t>(end - begin), POSIX_FADV_SEQUENTIAL);
+
+        slots = std::max<unsigned>(slots, 2);
+        slots_.resize(slots);
+        for (Slot& s : slots_) {
+            s.buf = static_cast<char*>(std::aligned_alloc(kAlign, kChunk));
+            if (!s.buf) { std::perror("aligned_alloc"); return false; }
+        }
+
+        t0_ = std::chrono::steady_clock::now();
+        switch (backend) {
+            case IoBackend::Stdio:
+                readers_.emplace_back([this, path] { read_stdio(path); });
+                break;
+            case IoBackend::Uring:
+#if BRC_URING
+                if (uring_.init(std::min<unsigned>(kUringDepth, slots))) {
+                    readers_.emplace_back([this] { read_uring(); });
+                    break;
+                }
+#endif
+                std::fprintf(stderr, "io: io_uring unavailable, using pread\n");
+                stats_.backend = IoBackend::Pread;
+                [[fallthrough]];
+            default:
+                for (unsigned i = 0; i < std::min<unsigned>(kPreadThreads, slots); ++i) {
+                    readers_.emplace_back([this] { read_pread(); });
+                }
+                break;
+        }
+        return true;
+    }
+
+    std::uint64_t chunks() const { return n_chunks_; }
+
+    // Blocks until chunk c is loaded and returns its bytes within [begin, end);
+    // an empty view with failed() set means the read failed.
+    std::string_view wait(std::uint64_t c) {
+        Slot& s = slots_[c % slots_.size()];
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [&] { return s.loaded == c || failed_; });
+        if (failed_) return {};
+        const std::uint64_t off = base_ + c * kChunk;
+        const std::uint64_t lead = c == 0 ? begin_ - base_ : 0;
+        const std::uint64_t stop = std::min<std::uint64_t>(off + s.len, end_);
+        return stop > off + lead ? std::string_view(s.buf + lead, static_cast<std::size_t>(stop - off - lead))
+                                 : std::string_view{};
+    }
+
+    void release(std::uint64_t c) {
+        std::lock_guard<std::mutex> lk(mu_);
+        slots_[c % slots_.size()].released = c;
+        cv_.notify_all();
+    }
+
+    bool failed() const { return failed_.load(); }
+
+    // Joins the readers; false if any read failed. Finishing before every
+    // chunk was loaded aborts the readers.
+    bool finish() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (done_ < n_chunks_) failed_ = true;
+            cv_.notify_all();
+        }
+        for (auto& t : readers_) t.join();
+        stats_.reads = reads_.load();
+        readers_.clear();
+        for (Slot& s : slots_) std::free(s.buf);
+        slots_.clear();
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        return !failed_;
+    }
+
+    const IoStats& stats() const { return stats_; }
+
+private:
+    struct Slot {
+        char*         buf = nullptr;
+        std::size_t   len = 0;
+        std::uint64_t loaded = UINT64_MAX;     // chunk currently held
+        std::uint64_t released = UINT64_MAX;   // last chunk consumers gave back
+        std::size_t   done = 0;                // uring: bytes read so far
+#if BRC_URING
+        iovec         iov{};
+#endif
+    };
+
+    std::uint64_t chunk_off(std::uint64_t c) const { return base_ + c * kChunk; }
+
+    // Bytes to request for chunk c; O_DIRECT lengths stay block multiples.
+    std::size_t chunk_want(std::uint64_t c) const {
+        std::uint64_t stop = stats_.direct ? (end_ + kAlign - 1) / kAlign * kAlign : end_;
+        return static_cast<std::size_t>(std::min<std::uint64_t>(kChunk, stop - chunk_off(c)));
+    }
+
+    bool slot_free(std::uint64_t c) const {
+        const Slot& s = slots_[c % slots_.size()];
+        return c < slots_.size() || s.released == c - slots_.size();
+    }
+
+    // Waits until chunk c's slot is free; false on failure.
+    Slot* acquire(std::uint64_t c) {
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [&] { return slot_free(c) || failed_; });
+        return failed_ ? nullptr : &slots_[c % slots_.size()];
+    }
+
+    void publish(std::uint64_t c, std::size_t len) {
+        std::lock_guard<std::mutex> lk(mu_);
+        Slot& s = slots_[c % slots_.size()];
+        s.len = len;
+        s.loaded = c;
+        stats_.bytes += std::min<std::uint64_t>(len, end_ - chunk_off(c));
+        if (++done_ == n_chunks_) {
+            stats_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0_).count();
+        }
+        cv_.notify_all();
+    }
+
+    void fail(const char* what) {
+        std::perror(what);
+        std::lock_guard<std::mutex> lk(mu_);
+        failed_ = true;
+        cv_.notify_all();
+    }
+
+    // Reads until `want` bytes or EOF; returns bytes read or -1.
+    ssize_t pread_full(char* buf, std::size_t want, std::uint64_t off) {
+        std::size_t got = 0;
+        while (got < want) {
+            ssize_t r = ::pread(fd_, buf + got, want - got, static_cast<off_t>(off + got));
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0) return -1;
+            reads_.fetch_add(1, std::memory_order_relaxed);
+            if (r == 0) break;
+            got += static_cast<std::size_t>(r);
+        }
+        return static_cast<ssize_t>(got);
+    }
+
+    void read_pread() {
+        for (;;) {
+            std::uint64_t c;
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                if (failed_ || next_pread_ >= n_chunks_) break;
+                c = next_pread_++;
+            }
+            Slot* s = acquire(c);
+            if (!s) break;
+            ssize_t got = pread_full(s->buf, chunk_want(c), chunk_off(c));
+            if (got < 0) { fail("pread"); break; }
+            publish(c, static_cast<std::size_t>(got));
+        }
+    }
+
+    void read_stdio(const char* path) {
+        FILE* fp = std::fopen(path, "rb");
+        if (!fp) { fail("fopen"); return; }
+        std::vector<char> stdio_buf(1 << 20);
+        std::setvbuf(fp, stdio_buf.data(), _IOFBF, stdio_buf.size());
+        if (::fseeko(fp, static_cast<off_t>(base_), SEEK_SET) != 0) { std::fclose(fp); fail("fseeko"); return; }
+        for (std::uint64_t c = 0; c < n_chunks_; ++c) {
+            Slot* s = acquire(c);
+            if (!s) break;
+            const std::size_t got = std::fread(s->buf, 1, chunk_want(c), fp);
+            reads_.fetch_add(1, std::memory_order_relaxed);
+            if (got < chunk_want(c) && std::ferror(fp)) { fail("fread"); break; }
+            publish(c, got);
+        }
+        std::fclose(fp);
+    }
+
+#if BRC_URING
+    void read_uring() {
+        std::uint64_t next = 0;
+        unsigned inflight = 0;
+        auto queue = [&](std::uint64_t c) {
+            Slot& s = slots_[c % slots_.size()];
+            s.iov.iov_base = s.buf + s.done;
+            s.iov.iov_len = chunk_want(c) - s.done;
+            uring_.queue_readv(fd_, &s.iov, chunk_off(c) + s.done, c);
+            reads_.fetch_add(1, std::memory_order_relaxed);
+        };
+
+        while (!failed_ && (next < n_chunks_ || inflight)) {
+            // Fill the queue with every chunk whose slot has been given back
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                while (next < n_chunks_ && inflight < kUringDepth && slot_free(next)) {
+                    slots_[next % slots_.size()].done = 0;
+                    queue(next++);
+                    ++inflight;
+                }
+            }
+            if (!inflight) {
+                if (!acquire(next)) break;   // every chunk is parked in a slot; wait for consumers
+                continue;
+            }
+            if (!uring_.submit(1)) { fail("io_uring_enter"); break; }
+
+            io_uring_cqe cqe;
+            while (uring_.pop(cqe)) {
+                const std::uint64_t c = cqe.user_data;
+                Slot& s = slots_[c % slots_.size()];
+                if (cqe.res < 0) {
+                    if (cqe.res == -EINTR || cqe.res == -EAGAIN) { queue(c); continue; }
+                    errno = -cqe.res;
+                    fail("io_uring read");
+                    return;
+                }
+                s.done += static_cast<std::size_t>(cqe.res);
+                if (cqe.res > 0 && s.done < chunk_want(c) && chunk_off(c) + s.done < end_) {
+                    queue(c);   // short read before EOF: ask for the rest
+                    continue;
+                }
+                --inflight;
+                publish(c, s.done);
+            }
+        }
+    }
+#endif
+
+    int                      fd_ = -1;
+    std::uint64_t            begin_ = 0, end_ = 0, base_ = 0, n_chunks_ = 0;
+    std::vector<Slot>        slots_;
+    std::vector<std::thread> readers_;
+    std::mutex               mu_;
+    std::condition_variable  cv_;
+    std::atomic<bool>        failed_{false};
+    std::uint64_t            next_pread_ = 0;
+    std::uint64_t            done_ = 0;
+    std::atomic<std::uint64_t> reads_{0};
+    IoStats                  stats_;
+    std::chrono::steady_clock::time_point t0_;
+#if BRC_URING
+    Uring                    uring_;
+#endif
+};
@@ -0,0 +1,51 @@
+// key_arena.hpp
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+// ---------- Key arena ----------
+// Bump-pointer storage for interned station names: every name is appended to
+// one contiguous buffer and referred to by (offset, length), so inserting a
+// key costs a memcpy instead of a heap allocation, and dropping a table frees
+// all its names at once. The buffer doubles when full, so a table with n keys
+// allocates O(log n) times in total and never on the per-row path. Offsets
+// stay valid across growth (pointers would not), and an arena can be appended
+// to another by rebasing offsets, which is how merged tables take ownership.
+// Each table owns its arena, so worker threads never share one.
+
+class KeyArena {
+public:
+    static constexpr std::uint64_t kMaxBytes = std::uint64_t{1} << 40;   // fits StationSlot::off
+    static constexpr std::size_t   kMinBlock = 64 << 10;
+
+    std::uint64_t add(std::string_view s) {
+        const std::uint64_t off = bytes_.size();
+        if (off + s.size() > kMaxBytes) {
+            std::fprintf(stderr, "key arena: more than %llu bytes of station names\n",
+                         static_cast<unsigned long long>(kMaxBytes));
+            std::abort();
+        }
+        if (bytes_.capacity() == 0) bytes_.reserve(kMinBlock);
+        bytes_.insert(bytes_.end(), s.begin(), s.end());
+        return off;
+    }
+
+    // Appends all of o; o's offset x is this arena's base + x afterwards.
+    std::uint64_t append(const KeyArena& o) { return add(std::string_view(o.bytes_.data(), o.bytes_.size())); }
+
+    const char* at(std::uint64_t off) const noexcept { return bytes_.data() + off; }
+    std::size_t size() const noexcept { return bytes_.size(); }
+
+    void reserve(std::size_t n) { bytes_.reserve(n); }
+    void clear() noexcept {
+        bytes_.clear();
+        bytes_.shrink_to_fit();
+    }
+
+private:
+    std::vector<char> bytes_;
+};
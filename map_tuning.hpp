@@ -0,0 +1,143 @@
+// map_tuning.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string_view>
+#include <thread>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// ---------- mmap input tuning ----------
+// Knobs for how the input mapping gets its pages:
+//   populate    MAP_POPULATE: fault everything in inside mmap(), up front
+//   sequential  MADV_SEQUENTIAL: aggressive readahead, early reclaim (default)
+//   hugepage    MADV_HUGEPAGE: 2 MiB mappings where the filesystem supports them
+//   willneed    MADV_WILLNEED: start readahead of the whole range immediately
+// Prefetch-ahead (SchedConfig::prefetch) is separate because it paces itself
+// on the scan: a background thread stays that many bytes ahead of the morsel
+// cursor, touching one byte per page so workers find the page tables filled.
+
+struct MapOptions {
+    bool populate = false;
+    bool sequential = true;
+    bool hugepage = false;
+    bool willneed = false;
+};
+
+// "sequential,hugepage,willneed" (or "none") into the madvise flags.
+inline bool parse_madvise(std::string_view list, MapOptions& mo) {
+    mo.sequential = mo.hugepage = mo.willneed = false;
+    while (!list.empty()) {
+        const std::size_t comma = list.find(',');
+        const std::string_view w = list.substr(0, comma);
+        if (w == "sequential") mo.sequential = true;
+        else if (w == "hugepage") mo.hugepage = true;
+        else if (w == "willneed") mo.willneed = true;
+        else if (w != "none") return false;
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+    return true;
+}
+
+// --prefetch MIB into SchedConfig::prefetch bytes; "0" turns it off.
+inline bool parse_prefetch(std::string_view mib, std::size_t& bytes) {
+    std::size_t v = 0;
+    const auto [end, ec] = std::from_chars(mib.data(), mib.data() + mib.size(), v);
+    if (ec != std::errc() || end != mib.data() + mib.size() || v > (std::size_t{1} << 20)) return false;   // <= 1 TiB
+    bytes = v << 20;
+    return true;
+}
+
+inline int map_flags(const MapOptions& mo) {
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (mo.populate) flags |= MAP_POPULATE;
+#endif
+    return flags;
+}
+
+inline void apply_madvise(void* p, std::size_t len, const MapOptions& mo) {
+    if (mo.sequential) ::madvise(p, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    if (mo.hugepage) ::madvise(p, len, MADV_HUGEPAGE);
+#endif
+    if (mo.willneed) ::madvise(p, len, MADV_WILLNEED);
+}
+
+// ---------- Prefetch-ahead ----------
+// Touches [base, base+len) page by page, never more than `ahead` bytes past
+// what progress() says the scan has claimed. Stops early when destroyed.
+class Prefetcher {
+public:
+    Prefetcher(const char* base, std::size_t len, std::size_t ahead, std::function<std::size_t()> progress)
+        : thread_([=, this] { run(base, len, ahead, progress); }) {}
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+    ~Prefetcher() {
+        stop_ = true;
+        thread_.join();
+    }
+
+    std::size_t touched() const { return touched_.load(); }
+
+private:
+    void run(const char* base, std::size_t len, std::size_t ahead, const std::function<std::size_t()>& progress) {
+        const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        constexpr std::size_t kStep = 1 << 20;
+        std::size_t pos = 0;
+        unsigned sink = 0;
+        while (pos < len && !stop_) {
+            if (pos >= progress() + ahead) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                continue;
+            }
+            const std::size_t end = std::min(len, pos + kStep);
+            ::madvise(const_cast<char*>(base) + pos / page * page, end - pos / page * page, MADV_WILLNEED);
+            for (; pos < end; pos += page) sink += static_cast<unsigned char>(*static_cast<const volatile char*>(base + pos));
+            touched_.store(std::min(pos, len), std::memory_order_relaxed);
+        }
+        sink_ = sink;
+    }
+
+    std::atomic<bool>        stop_{false};
+    std::atomic<std::size_t> touched_{0};
+    unsigned                 sink_ = 0;
+    std::thread              thread_;
+};
+
+// ---------- Page-fault accounting ----------
+// Process-wide counts from getrusage. Fault handling runs in the kernel, so
+// system CPU time is the cost side of the same ledger.
+struct FaultSnapshot {
+    long   minor = 0;
+    long   major = 0;
+    double sys_ms = 0.0;
+    double wall_ms = 0.0;
+
+    static FaultSnapshot now() {
+        struct rusage ru;
+        ::getrusage(RUSAGE_SELF, &ru);
+        FaultSnapshot s;
+        s.minor = ru.ru_minflt;
+        s.major = ru.ru_majflt;
+        s.sys_ms = static_cast<double>(ru.ru_stime.tv_sec) * 1e3 + static_cast<double>(ru.ru_stime.tv_usec) / 1e3;
+        s.wall_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        return s;
+    }
+};
+
+inline void report_faults(FILE* fp, const FaultSnapshot& a, const FaultSnapshot& b) {
+    std::fprintf(fp, "faults: %ld minor, %ld major, %.1f ms system time over %.1f ms wall\n",
+                 b.minor - a.minor, b.major - a.major, b.sys_ms - a.sys_ms, b.wall_ms - a.wall_ms);
+}
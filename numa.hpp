@@ -0,0 +1,178 @@
+// numa.hpp
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+// ---------- NUMA topology ----------
+// Read straight from sysfs, so there is no libnuma dependency:
+//   /sys/devices/system/node/online        "0-1"
+//   /sys/devices/system/node/nodeN/cpulist "0-15,32-47"
+// CPUs outside this process's affinity mask are dropped, as are nodes left
+// without CPUs (memory-only nodes). Without sysfs the whole machine is one node.
+
+struct NumaNode {
+    int              id = 0;
+    std::vector<int> cpus;
+};
+
+namespace numa_detail {
+
+inline bool read_line(const std::string& path, std::string& out) {
+    FILE* fp = std::fopen(path.c_str(), "r");
+    if (!fp) return false;
+    char buf[4096];
+    const bool ok = std::fgets(buf, sizeof buf, fp) != nullptr;
+    std::fclose(fp);
+    if (ok) {
+        out = buf;
+        while (!out.empty() && (out.back() == '\n' || out.back() == ' ')) out.pop_back();
+    }
+    return ok;
+}
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+inline std::vector<int> parse_list(const std::string& s) {
+    std::vector<int> out;
+    const char* p = s.c_str();
+    while (*p) {
+        char* e;
+        long a = std::strtol(p, &e, 10);
+        if (e == p) break;
+        long b = a;
+        p = e;
+        if (*p == '-') {
+            b = std::strtol(p + 1, &e, 10);
+            p = e;
+        }
+        for (long x = a; x <= b; ++x) out.push_back(static_cast<int>(x));
+        if (*p == ',') ++p;
+    }
+    return out;
+}
+
+}  // namespace numa_detail
+
+inline std::vector<NumaNode> numa_nodes() {
+    using namespace numa_detail;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool have_mask = ::sched_getaffinity(0, sizeof allowed, &allowed) == 0;
+
+    std::vector<NumaNode> nodes;
+    std::string online;
+    if (read_line("/sys/devices/system/node/online", online)) {
+        for (int id : parse_list(online)) {
+            std::string list;
+            if (!read_line("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist", list)) continue;
+            NumaNode n;
+            n.id = id;
+            for (int c : parse_list(list)) {
+                if (!have_mask || (c < CPU_SETSIZE && CPU_ISSET(c, &allowed))) n.cpus.push_back(c);
+            }
+            if (!n.cpus.empty()) nodes.push_back(std::move(n));
+        }
+    }
+    if (nodes.empty()) {
+        NumaNode n;
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (have_mask ? CPU_ISSET(c, &allowed) : c < static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN))) n.cpus.push_back(c);
+        }
+        if (n.cpus.empty()) n.cpus.push_back(0);
+        nodes.push_back(std::move(n));
+    }
+    return nodes;
+}
+
+// ---------- Placement ----------
+// Both apply to the calling thread and are inherited by threads it creates,
+// so a per-node leader sets them once and spawns its workers.
+
+inline bool pin_to_cpus(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    return ::sched_setaffinity(0, sizeof set, &set) == 0;
+}
+
+// New pages this thread touches first come from `node` while it has memory.
+inline bool prefer_node(int node) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    unsigned long mask[16] = {};
+    if (node < 0 || node >= static_cast<int>(sizeof mask * 8)) return false;
+    mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+    return ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof mask * 8) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+// ---------- Local vs remote memory accesses ----------
+// The generic "node" cache events: node-loads counts loads that went to DRAM,
+// node-load-misses the ones served by a remote node. Counted for this process
+// and every thread created after start(); unavailable on many VMs.
+class NodeAccessCounters {
+public:
+    bool start() {
+#if defined(__linux__)
+        loads_ = open(PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+        misses_ = open(PERF_COUNT_HW_CACHE_RESULT_MISS);
+#endif
+        return loads_ >= 0 && misses_ >= 0;
+    }
+
+    // False when the counters are unavailable.
+    bool read(double& local, double& remote) {
+        double l = value(loads_), m = value(misses_);
+        if (l < 0 || m < 0) return false;
+        local = l - m;
+        remote = m;
+        return true;
+    }
+
+    ~NodeAccessCounters() {
+        if (loads_ >= 0) ::close(loads_);
+        if (misses_ >= 0) ::close(misses_);
+    }
+
+private:
+#if defined(__linux__)
+    static int open(std::uint64_t result) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof attr);
+        attr.size = sizeof attr;
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+    // Scaled for multiplexing; -1 when unavailable.
+    static double value(int fd) {
+        if (fd < 0) return -1.0;
+        std::uint64_t v[3] = {0, 0, 0};
+        if (::read(fd, v, sizeof v) != static_cast<ssize_t>(sizeof v) || v[2] == 0) return -1.0;
+        return static_cast<double>(v[0]) * static_cast<double>(v[1]) / static_cast<double>(v[2]);
+    }
+
+    int loads_ = -1;
+    int misses_ = -1;
+};
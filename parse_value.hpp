@@ -0,0 +1,216 @@
+// parse_value.hpp
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// ---------- Measurement value parsing ----------
+// parse_double reads a decimal from [first, last) without allocating, without
+// NUL termination and without looking at the locale. The result is correctly
+// rounded (bit-identical to strtod):
+//   * up to 2^53 with |exp10| <= 22: one exact double multiply/divide (Clinger);
+//   * up to 19 significant digits with |exp10| <= 19: exact 128-bit integer
+//     multiply/divide, then round-half-even to 53 bits. This covers the
+//     17-digit values create_test_samples.py writes (e.g. -3.1415926535897931);
+//   * anything else (more digits, huge exponents, inf/nan): strtod on a copy.
+// Returns the pointer past the parsed text, or nullptr if nothing parsed.
+
+namespace parse_detail {
+
+inline constexpr double kPow10d[23] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+inline constexpr std::uint64_t kPow10u[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+    1000000000000ull, 10000000000000ull, 100000000000000ull,
+    1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull,
+};
+
+using u128 = unsigned __int128;
+
+inline int bit_length(u128 x) {
+    std::uint64_t hi = static_cast<std::uint64_t>(x >> 64);
+    if (hi) return 128 - __builtin_clzll(hi);
+    std::uint64_t lo = static_cast<std::uint64_t>(x);
+    return lo ? 64 - __builtin_clzll(lo) : 0;
+}
+
+// (q + sticky) * 2^e2 rounded half-to-even; q must carry >= 54 bits when sticky
+// is set. Builds the IEEE bits directly: every caller lands in the normal range.
+inline double round_to_double(u128 q, bool sticky, int e2, bool neg) {
+    int n = bit_length(q);
+    std::uint64_t m;
+    int shift = n - 53;
+    if (shift <= 0) {
+        m = static_cast<std::uint64_t>(q) << -shift;
+    } else {
+        m = static_cast<std::uint64_t>(q >> shift);
+        u128 rem  = q & ((static_cast<u128>(1) << shift) - 1);
+        u128 half = static_cast<u128>(1) << (shift - 1);
+        if (rem > half || (rem == half && (sticky || (m & 1)))) {
+            if (++m == (1ull << 53)) { m >>= 1; ++shift; }
+        }
+    }
+    std::uint64_t biased = static_cast<std::uint64_t>(e2 + shift + 52 + 1023);
+    std::uint64_t bits = (biased << 52) | (m & ((1ull << 52) - 1));
+    if (neg) bits |= 1ull << 63;
+    double d;
+    std::memcpy(&d, &bits, sizeof d);
+    return d;
+}
+
+inline const char* parse_fallback(const char* first, const char* last, double& out) {
+    char buf[128];
+    std::size_t n = static_cast<std::size_t>(last - first);
+    if (n >= sizeof buf) return nullptr;
+    std::memcpy(buf, first, n);
+    buf[n] = '\0';
+    char* endp = nullptr;
+    out = std::strtod(buf, &endp);
+    return endp == buf ? nullptr : first + (endp - buf);
+}
+
+}  // namespace parse_detail
+
+inline const char* parse_double(const char* first, const char* last, double& out) {
+    using namespace parse_detail;
+    const char* p = first;
+    bool neg = false;
+    if (p < last && (*p == '-' || *p == '+')) { neg = (*p == '-'); ++p; }
+
+    std::uint64_t w = 0;
+    int sig = 0;          // significant digits folded into w
+    int exp10 = 0;
+    bool any = false;
+
+    while (p < last && *p == '0') { ++p; any = true; }
+    while (p < last && static_cast<unsigned>(*p - '0') < 10) {
+        if (sig < 19) { w = w * 10 + static_cast<unsigned>(*p - '0'); ++sig; }
+        else          { return parse_fallback(first, last, out); }
+        ++p; any = true;
+    }
+    if (p < last && *p == '.') {
+        ++p;
+        if (w == 0) {
+            while (p < last && *p == '0') { ++p; --exp10; any = true; }
+        }
+        while (p < last && static_cast<unsigned>(*p - '0') < 10) {
+            if (sig < 19) { w = w * 10 + static_cast<unsigned>(*p - '0'); ++sig; --exp10; }
+            else          { return parse_fallback(first, last, out); }
+            ++p; any = true;
+        }
+    }
+    if (!any) return parse_fallback(first, last, out);  // inf/nan/garbage
+
+    if (p < last && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool eneg = false;
+        if (q < last && (*q == '-' || *q == '+')) { eneg = (*q == '-'); ++q; }
+        if (q < last && static_cast<unsigned>(*q - '0') < 10) {
+            int e = 0;
+            while (q < last && static_cast<unsigned>(*q - '0') < 10) {
+                if (e < 100000) e = e * 10 + (*q - '0');
+                ++q;
+            }
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    if (w == 0) { out = neg ? -0.0 : 0.0; return p; }
+
+    // Clinger fast path: both operands exact, one correctly rounded op.
+    if (w <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+        double d = static_cast<double>(w);
+        d = exp10 < 0 ? d / kPow10d[-exp10] : d * kPow10d[exp10];
+        out = neg ? -d : d;
+        return p;
+    }
+
+    if (exp10 < 0 && exp10 >= -19) {
+        // w / 10^k: scale w so the quotient keeps >= 62 bits, remainder -> sticky.
+        const std::uint64_t d = kPow10u[-exp10];
+        const int s = 64 + (64 - __builtin_clzll(d)) - (64 - __builtin_clzll(w)) - 1;
+        const u128 num = static_cast<u128>(w) << s;
+        const u128 q = num / d;
+        const bool sticky = (num - q * d) != 0;
+        out = round_to_double(q, sticky, -s, neg);
+        return p;
+    }
+    if (exp10 >= 0 && exp10 <= 19) {
+        out = round_to_double(static_cast<u128>(w) * kPow10u[exp10], false, 0, neg);
+        return p;
+    }
+    return parse_fallback(first, last, out);
+}
+
+// ---------- Fixed one-decimal fast path (classic 1BRC format) ----------
+// Decodes "-?\d{1,2}\.\d" into tenths without branches. Needs 8 readable bytes
+// at p (the caller guarantees padding); *end is set past the last digit.
+// Only for tokens is_fixed1 accepts: "-0.0" would come back as +0.
+inline int parse_fixed1_swar(const char* p, const char** end) {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof word);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    // '.' (0x2E) is the only byte of the pattern with bit 4 clear after a digit
+    const int dot = __builtin_ctzll(~word & 0x10101000ull);
+    const int shift = 28 - dot;
+    const std::int64_t sign = static_cast<std::int64_t>(~word << 59) >> 63;  // -1 if '-'
+    const std::uint64_t design = ~static_cast<std::uint64_t>(sign & 0xFF);
+    const std::uint64_t digits = ((word & design) << shift) & 0x0F000F0F00ull;
+    const std::int64_t abs = static_cast<std::int64_t>(((digits * 0x640a0001ull) >> 32) & 0x3FF);
+    *end = p + (dot >> 3) + 2;
+    return static_cast<int>((abs ^ sign) - sign);
+}
+
+// ---------- Fixed N-decimal values ----------
+// Strict "-?\d+\.\d{N}" spanning exactly [first, last), at most 15 digits in
+// all so units is exact in a double. units is the value in 10^-N steps; v is
+// the same correctly rounded double parse_double gives (one exact-integer
+// division), -0.0 included. False on any other shape.
+template <int N>
+inline bool parse_fixed(const char* first, const char* last, std::int64_t& units, double& v) {
+    static_assert(N >= 1 && N <= 3);
+    const bool neg = first < last && *first == '-';
+    const char* p = first + neg;
+    const char* dot = last - N - 1;
+    if (dot <= p || dot - p > 15 - N || *dot != '.') return false;
+    std::int64_t u = 0;
+    for (; p < last; ++p) {
+        if (p == dot) continue;
+        const unsigned d = static_cast<unsigned>(*p - '0');
+        if (d > 9) return false;
+        u = u * 10 + d;
+    }
+    v = static_cast<double>(u) / parse_detail::kPow10d[N];
+    if (neg) {
+        u = -u;
+        v = -v;
+    }
+    units = u;
+    return true;
+}
+
+// True when [first, last) has the fixed one-decimal shape parse_fixed1_swar
+// expects. -0.0 is refused: tenths cannot carry its sign, and parse_double
+// keeps it.
+inline bool is_fixed1(const char* first, const char* last) {
+    if (last - first < 3) return false;
+    const bool neg = (*first == '-');
+    const std::size_t n = static_cast<std::size_t>(last - first) - neg;
+    if (n < 3 || n > 4 || last[-2] != '.') return false;
+    // The digits: leading, before and after the dot (leading is the one before
+    // the dot again when there is no tens digit).
+    const auto byte = [](char c, int k) { return static_cast<std::uint32_t>(static_cast<unsigned char>(c)) << k; };
+    const std::uint32_t w = byte(first[neg], 16) | byte(last[-3], 8) | byte(last[-1], 0) | 0x30000000u;
+    // Every byte in '0'..'9' (none borrows below 0x30 or carries past 0x39),
+    // and not all zeros after a '-'.
+    const std::uint32_t bad = ((w - 0x30303030u) | (w + 0x46464646u)) & 0x80808080u;
+    return (bad | static_cast<std::uint32_t>(neg & (w == 0x30303030u))) == 0;
+}
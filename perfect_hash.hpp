@@ -0,0 +1,203 @@
+// perfect_hash.hpp
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "hash_suite.hpp"
+
+// ---------- Station dictionary ----------
+// A minimal perfect hash over a fixed station list, PTHash-style: key hashes
+// are split into buckets of about four, and each bucket, largest first, gets
+// a displacement that sends all its keys to free slots of [0, n). A lookup is
+// then one key hash, one displacement load and one verification compare
+// against the name stored at the slot, with no probing; a name outside the
+// list fails the compare and returns kMiss.
+//
+// The key hash only has to separate the listed names, so it is as cheap as
+// they allow: the first 8 bytes and the length through one multiply when that
+// is collision-free over the list (true for typical station names), else the
+// full WordHash. Verification always compares the whole name.
+class StationDictionary {
+public:
+    static constexpr std::uint32_t kMiss = UINT32_MAX;
+
+    // Builds over the distinct non-empty names; false when there are none or
+    // no displacement set was found (not expected below millions of names).
+    bool build(const std::vector<std::string_view>& names) {
+        clear();
+        std::unordered_set<std::string_view> seen;
+        std::vector<std::string_view> keys;
+        for (std::string_view s : names) {
+            if (!s.empty() && seen.insert(s).second) keys.push_back(s);
+        }
+        if (keys.empty()) return false;
+        n_ = static_cast<std::uint32_t>(keys.size());
+        n_buckets_ = (n_ + 3) / 4;
+
+        std::vector<std::uint64_t> w0(n_), w1(n_);
+        for (std::uint32_t i = 0; i < n_; ++i) hash_detail::first_block(keys[i].data(), keys[i].size(), w0[i], w1[i]);
+
+        std::vector<std::uint64_t> h(n_);
+        for (int attempt = 0; attempt < 16; ++attempt) {
+            narrow_ = attempt < 8;
+            seed_ = hash_detail::kSeed2 * static_cast<std::uint64_t>(2 * attempt + 1);
+            for (std::uint32_t i = 0; i < n_; ++i) h[i] = key_hash(w0[i], w1[i], keys[i].data(), keys[i].size());
+            if (place(h)) {
+                fill(keys, h, w0, w1);
+                return true;
+            }
+        }
+        clear();
+        return false;
+    }
+
+    // Dense index of the name [p, p+len), or kMiss. Reads up to 16 bytes
+    // from p when p + 16 <= limit.
+    std::uint32_t find(const char* p, std::size_t len, const char* limit) const noexcept {
+        using namespace hash_detail;
+        std::uint64_t a, b;
+        if (p + 16 <= limit) {
+            a = low_bytes(load8(p), len);
+            b = len > 8 ? low_bytes(load8(p + 8), len - 8) : 0;
+        } else {
+            first_block(p, len, a, b);
+        }
+        const std::uint64_t h = key_hash(a, b, p, len);
+        const std::uint32_t i = slot_of(h, displacement_[bucket_of(h)]);
+        const Entry& e = entries_[i];
+        if (e.w0 != a || e.w1 != b || e.len != len) return kMiss;
+        if (len > 16 && std::memcmp(p + 16, arena_.data() + e.off + 16, len - 16) != 0) return kMiss;
+        return i;
+    }
+    std::uint32_t find(std::string_view s) const noexcept { return n_ ? find(s.data(), s.size(), s.data()) : kMiss; }
+
+    std::string_view name(std::uint32_t i) const { return {arena_.data() + entries_[i].off, entries_[i].len}; }
+    std::uint32_t size() const { return n_; }
+    bool empty() const { return n_ == 0; }
+    bool narrow() const { return narrow_; }
+    std::size_t bytes() const { return displacement_.size() * sizeof(std::uint64_t) + entries_.size() * sizeof(Entry); }
+
+    void clear() {
+        n_ = n_buckets_ = 0;
+        displacement_.clear();
+        entries_.clear();
+        arena_.clear();
+    }
+
+private:
+    struct Entry {
+        std::uint64_t w0 = 0, w1 = 0;   // first_block of the name
+        std::uint32_t len = UINT32_MAX;   // no name matches an unused entry
+        std::uint32_t off = 0;            // name in arena_
+    };
+
+    std::uint64_t key_hash(std::uint64_t a, std::uint64_t b, const char* p, std::size_t len) const noexcept {
+        using namespace hash_detail;
+        return narrow_ ? fold_mul(a ^ seed_, kSeed1 ^ len) : WordHash::words(a ^ seed_, b, p, len);
+    }
+    std::uint32_t bucket_of(std::uint64_t h) const noexcept {
+        return static_cast<std::uint32_t>((h & 0xffffffffu) * n_buckets_ >> 32);
+    }
+    // The multiply carries every bit of h ^ d into the top bits the range
+    // reduction keeps; a plain xor would leave keys that share their top
+    // bits on the same slot for every d.
+    std::uint32_t slot_of(std::uint64_t h, std::uint64_t d) const noexcept {
+        return static_cast<std::uint32_t>(static_cast<unsigned __int128>((h ^ d) * hash_detail::kSeed0) * n_ >> 64);
+    }
+    static std::uint64_t mix(std::uint64_t x) noexcept {   // splitmix64 finalizer
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    bool place(const std::vector<std::uint64_t>& h) {
+        {   // equal key hashes can never be split apart
+            std::vector<std::uint64_t> sorted(h);
+            std::sort(sorted.begin(), sorted.end());
+            if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) return false;
+        }
+        std::vector<std::vector<std::uint32_t>> buckets(n_buckets_);
+        for (std::uint32_t i = 0; i < n_; ++i) buckets[bucket_of(h[i])].push_back(i);
+        std::vector<std::uint32_t> order(n_buckets_);
+        for (std::uint32_t b = 0; b < n_buckets_; ++b) order[b] = b;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](std::uint32_t a, std::uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        displacement_.assign(n_buckets_, 0);
+        std::vector<char> taken(n_, 0);
+        std::vector<std::uint32_t> slots;
+        for (std::uint32_t b : order) {
+            const std::vector<std::uint32_t>& keys = buckets[b];
+            if (keys.empty()) break;
+            bool placed = false;
+            for (std::uint64_t pilot = 0; pilot < (1u << 24) && !placed; ++pilot) {
+                const std::uint64_t d = mix(pilot ^ seed_);
+                slots.clear();
+                placed = true;
+                for (std::uint32_t k : keys) {
+                    const std::uint32_t s = slot_of(h[k], d);
+                    if (taken[s] || std::find(slots.begin(), slots.end(), s) != slots.end()) {
+                        placed = false;
+                        break;
+                    }
+                    slots.push_back(s);
+                }
+                if (placed) {
+                    displacement_[b] = d;
+                    for (std::uint32_t s : slots) taken[s] = 1;
+                }
+            }
+            if (!placed) return false;
+        }
+        return true;
+    }
+
+    void fill(const std::vector<std::string_view>& keys, const std::vector<std::uint64_t>& h,
+              const std::vector<std::uint64_t>& w0, const std::vector<std::uint64_t>& w1) {
+        entries_.assign(n_, Entry{});
+        for (std::uint32_t i = 0; i < n_; ++i) {
+            Entry& e = entries_[slot_of(h[i], displacement_[bucket_of(h[i])])];
+            e = {w0[i], w1[i], static_cast<std::uint32_t>(keys[i].size()), static_cast<std::uint32_t>(arena_.size())};
+            arena_.append(keys[i]);
+        }
+    }
+
+    std::uint32_t              n_ = 0;
+    std::uint32_t              n_buckets_ = 0;
+    bool                       narrow_ = true;
+    std::uint64_t              seed_ = 0;
+    std::vector<std::uint64_t> displacement_;   // per bucket
+    std::vector<Entry>         entries_;        // per slot
+    std::string                arena_;
+};
+
+// One name per line, up to an optional ';' (so a sample of the input itself
+// works as a list); '\r' trimmed, empty lines skipped.
+inline bool load_station_list(const char* path, std::vector<std::string>& out) {
+    FILE* fp = std::fopen(path, "rb");
+    if (!fp) {
+        std::perror(path);
+        return false;
+    }
+    std::string line;
+    char buf[4096];
+    while (std::fgets(buf, sizeof buf, fp)) {
+        line += buf;
+        if (line.back() != '\n' && !std::feof(fp)) continue;   // longer than buf
+        std::size_t end = line.find_first_of(";\r\n");
+        if (end == std::string::npos) end = line.size();
+        if (end) out.emplace_back(line, 0, end);
+        line.clear();
+    }
+    const bool ok = !std::ferror(fp);
+    std::fclose(fp);
+    if (!ok) std::perror(path);
+    return ok;
+}
@@ -0,0 +1,336 @@
+// query_server.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "format_results.hpp"
+
+// ---------- Station snapshot ----------
+// An immutable, query-ready copy of a result table: every station's
+// "name;mean;min;max\n" line, formatted once and sorted by name into one
+// buffer, plus an index of where each line starts. All stations, a prefix or
+// a name range is then one contiguous slice found by binary search, so a query
+// costs a lookup and a send, whatever the table size.
+class StationSnapshot {
+public:
+    template <class Table>
+    StationSnapshot(const Table& table, FormatOptions fo, std::uint64_t offset, std::uint64_t generation)
+        : text_(64 + table.size() * 64), offset_(offset), generation_(generation) {
+        fo.sorted = true;
+        fo.canonical = false;
+        format_results(table, fo, text_);
+        const std::string_view all = text_.view();
+        lines_.reserve(table.size());
+        for (std::size_t pos = 0; pos < all.size();) {
+            const std::size_t nl = all.find('\n', pos);
+            const std::size_t semi = all.find(';', pos);
+            lines_.push_back({all.substr(pos, semi - pos), pos});
+            pos = nl + 1;
+        }
+    }
+
+    std::string_view all() const { return text_.view(); }
+
+    // The station's line, or empty.
+    std::string_view get(std::string_view name) const {
+        const std::size_t i = lower(name);
+        return i < lines_.size() && lines_[i].name == name ? slice(i, i + 1) : std::string_view{};
+    }
+
+    // Lines of the stations whose name starts with p.
+    std::string_view prefix(std::string_view p) const {
+        const std::size_t a = lower(p);
+        return slice(a, upper_prefix(p, a));
+    }
+
+    // Lines of the stations with lo <= name < hi.
+    std::string_view range(std::string_view lo, std::string_view hi) const {
+        const std::size_t a = lower(lo);
+        return slice(a, std::max(a, lower(hi)));
+    }
+
+    std::size_t   stations() const { return lines_.size(); }
+    std::uint64_t offset() const { return offset_; }
+    std::uint64_t generation() const { return generation_; }
+
+private:
+    struct Line {
+        std::string_view name;
+        std::size_t      pos;    // start of the line in text_
+    };
+
+    std::size_t lower(std::string_view key) const {
+        return static_cast<std::size_t>(
+            std::lower_bound(lines_.begin(), lines_.end(), key,
+                             [](const Line& l, std::string_view k) { return l.name < k; }) - lines_.begin());
+    }
+
+    // First index at or after a whose name does not start with p.
+    std::size_t upper_prefix(std::string_view p, std::size_t a) const {
+        return static_cast<std::size_t>(
+            std::partition_point(lines_.begin() + static_cast<std::ptrdiff_t>(a), lines_.end(),
+                                 [&](const Line& l) { return l.name.starts_with(p); }) - lines_.begin());
+    }
+
+    std::string_view slice(std::size_t a, std::size_t b) const {
+        if (a >= b) return {};
+        const std::size_t end = b < lines_.size() ? lines_[b].pos : text_.view().size();
+        return text_.view().substr(lines_[a].pos, end - lines_[a].pos);
+    }
+
+    OutBuffer         text_;
+    std::vector<Line> lines_;
+    std::uint64_t     offset_ = 0;
+    std::uint64_t     generation_ = 0;
+};
+
+// ---------- Query server ----------
+// Line protocol over a Unix stream socket; one request per line, answered by
+// zero or more result lines and then an empty line:
+//   ALL                every station
+//   GET name           one station (names may contain spaces)
+//   PREFIX text        stations whose name starts with text
+//   RANGE lo;hi        stations with lo <= name < hi
+//   INFO               stations, bytes ingested and refresh count
+// Errors come back as a single "ERR ..." line. Clients are served from one
+// poll loop against the latest published snapshot; publishing swaps a
+// shared_ptr, so an ingest never blocks a query for longer than the swap.
+// Sockets are non-blocking: what a client has not read yet stays queued for
+// it, and once that passes kMaxBacklog its further requests wait (unread, so
+// they back up in its own socket) until it catches up. A client that stops
+// reading stalls only itself.
+class QueryServer {
+public:
+    static constexpr std::size_t kMaxBacklog = 1 << 20;   // unsent bytes per client
+    ~QueryServer() {
+        for (const Client& c : clients_) ::close(c.fd);
+        if (listen_fd_ >= 0) {
+            ::close(listen_fd_);
+            ::unlink(path_.c_str());
+        }
+    }
+
+    bool listen(const char* path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (std::strlen(path) >= sizeof addr.sun_path) {
+            std::fprintf(stderr, "socket path too long: %s\n", path);
+            return false;
+        }
+        std::strcpy(addr.sun_path, path);
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (listen_fd_ < 0) { std::perror("socket"); return false; }
+        ::unlink(path);   // a stale socket from an earlier run
+        if (::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof addr) != 0 ||
+            ::listen(listen_fd_, 64) != 0) {
+            std::perror("bind");
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        path_ = path;
+        return true;
+    }
+
+    void publish(std::shared_ptr<const StationSnapshot> snap) {
+        std::lock_guard<std::mutex> lk(mu_);
+        snap_ = std::move(snap);
+    }
+
+    // Serves until stop is set (checked at least every 200 ms).
+    void run(const std::atomic<bool>& stop) {
+        std::vector<pollfd> fds;
+        while (!stop) {
+            fds.assign(1, {listen_fd_, POLLIN, 0});
+            for (const Client& c : clients_) {
+                const short want = static_cast<short>((c.backlog() < kMaxBacklog ? POLLIN : 0) | (c.backlog() ? POLLOUT : 0));
+                fds.push_back({c.fd, want, 0});
+            }
+            if (::poll(fds.data(), fds.size(), 200) <= 0) continue;
+            if (fds[0].revents & POLLIN) accept_all();   // appends: the indices below stay valid
+            for (std::size_t i = 1; i < fds.size(); ++i) {
+                if (fds[i].revents) serve(clients_[i - 1], fds[i].revents);
+            }
+            std::erase_if(clients_, [](const Client& c) { return c.fd < 0; });
+        }
+    }
+
+private:
+    struct Client {
+        int         fd;
+        std::string in;          // received bytes not answered yet
+        std::string out;         // answers; [sent, size) not sent yet
+        std::size_t sent = 0;
+
+        std::size_t backlog() const { return out.size() - sent; }
+    };
+
+    void accept_all() {
+        for (;;) {
+            const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (fd < 0) return;
+            clients_.push_back({fd, {}, {}, 0});
+        }
+    }
+
+    void serve(Client& c, short revents) {
+        if (revents & POLLIN) {
+            char buf[4096];
+            const ssize_t n = ::recv(c.fd, buf, sizeof buf, 0);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                drop(c);
+                return;
+            }
+            if (n > 0) c.in.append(buf, static_cast<std::size_t>(n));
+        } else if (revents & (POLLHUP | POLLERR)) {
+            drop(c);
+            return;
+        }
+        // Requests already received get answered as the backlog drains,
+        // without waiting for more input
+        for (;;) {
+            answer_lines(c);
+            if (!flush(c)) {
+                drop(c);
+                return;
+            }
+            if (c.backlog() >= kMaxBacklog || c.in.find('\n') == std::string::npos) break;
+        }
+    }
+
+    // Answers the complete request lines in c.in while c's backlog is under the cap.
+    void answer_lines(Client& c) {
+        std::size_t start = 0;
+        for (std::size_t nl; c.backlog() < kMaxBacklog && (nl = c.in.find('\n', start)) != std::string::npos; start = nl + 1) {
+            std::string_view req(c.in.data() + start, nl - start);
+            if (!req.empty() && req.back() == '\r') req.remove_suffix(1);
+            answer(req, c.out);
+        }
+        c.in.erase(0, start);
+        if (c.in.size() > (1 << 16) && c.in.find('\n') == std::string::npos) {
+            c.out += "ERR request too long\n\n";
+            c.in.clear();
+        }
+    }
+
+    void answer(std::string_view req, std::string& out) {
+        std::shared_ptr<const StationSnapshot> snap;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            snap = snap_;
+        }
+        // Matches the request keyword and leaves its argument in req
+        auto word = [&](std::string_view w) {
+            if (!req.starts_with(w) || (req.size() > w.size() && req[w.size()] != ' ')) return false;
+            req.remove_prefix(std::min(req.size(), w.size() + 1));
+            return true;
+        };
+        if (!snap) {
+            out += "ERR no data yet\n";
+        } else if (word("ALL")) {
+            out += snap->all();
+        } else if (word("GET")) {
+            out += snap->get(req);
+        } else if (word("PREFIX")) {
+            out += snap->prefix(req);
+        } else if (word("RANGE")) {
+            const std::size_t semi = req.find(';');
+            if (semi == std::string_view::npos) out += "ERR usage: RANGE lo;hi\n";
+            else out += snap->range(req.substr(0, semi), req.substr(semi + 1));
+        } else if (word("INFO")) {
+            out += "stations " + std::to_string(snap->stations()) + "\n";
+            out += "offset " + std::to_string(snap->offset()) + "\n";
+            out += "refreshes " + std::to_string(snap->generation()) + "\n";
+        } else {
+            out += "ERR unknown request\n";
+        }
+        out += '\n';
+    }
+
+    // Sends as much of c's backlog as the socket takes now; false once the
+    // client is gone.
+    static bool flush(Client& c) {
+        while (c.backlog()) {
+            const ssize_t w = ::send(c.fd, c.out.data() + c.sent, c.backlog(), MSG_NOSIGNAL);
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (w <= 0) return false;
+            c.sent += static_cast<std::size_t>(w);
+        }
+        if (c.sent == c.out.size() || c.sent >= kMaxBacklog) {   // drop what went out
+            c.out.erase(0, c.sent);
+            c.sent = 0;
+        }
+        return true;
+    }
+
+    static void drop(Client& c) {
+        ::close(c.fd);
+        c.fd = -1;
+    }
+
+    int                                    listen_fd_ = -1;
+    std::string                            path_;
+    std::vector<Client>                    clients_;
+    std::mutex                             mu_;
+    std::shared_ptr<const StationSnapshot> snap_;
+};
+
+// ---------- Client ----------
+// Sends one request and copies the answer (without the closing empty line)
+// to out; prints the round trip to stderr. Returns false on socket errors.
+inline bool query_server(const char* path, std::string_view request, FILE* out) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof addr.sun_path) {
+        std::fprintf(stderr, "socket path too long: %s\n", path);
+        return false;
+    }
+    std::strcpy(addr.sun_path, path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) { std::perror("socket"); return false; }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof addr) != 0) {
+        std::perror("connect");
+        ::close(fd);
+        return false;
+    }
+    std::string req(request);
+    req += '\n';
+    std::string resp;
+    const auto t0 = std::chrono::steady_clock::now();
+    bool ok = ::send(fd, req.data(), req.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(req.size());
+    char buf[1 << 16];
+    // The answer ends at the first empty line: "\n\n", or a lone "\n" at the start
+    while (ok && !(resp == "\n" || (resp.size() >= 2 && resp.ends_with("\n\n")))) {
+        const ssize_t n = ::recv(fd, buf, sizeof buf, 0);
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        resp.append(buf, static_cast<std::size_t>(n));
+    }
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    ::close(fd);
+    if (!ok) {
+        std::fprintf(stderr, "query: connection closed before the answer ended\n");
+        return false;
+    }
+    std::fwrite(resp.data(), 1, resp.size() - 1, out);
+    std::fprintf(stderr, "%zu bytes in %.1f us\n", resp.size() - 1, us);
+    return true;
+}
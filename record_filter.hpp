@@ -0,0 +1,282 @@
+// record_filter.hpp
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "city_result.hpp"
+
+// ---------- Record schema ----------
+// Which ';'-separated field of a line holds the station, the value and the
+// timestamp, e.g. "city;ts;value"; "_" names a field that is skipped. The
+// default is the two-field 1BRC layout, "city;value".
+struct RecordSchema {
+    static constexpr int kMaxFields = 8;
+
+    int fields = 2;
+    int city = 0;
+    int value = 1;
+    int ts = -1;   // no timestamp field
+
+    bool plain() const { return fields == 2 && city == 0 && value == 1 && ts < 0; }
+    int  last_needed() const { return std::max(std::max(city, value), ts); }
+};
+
+inline bool parse_schema(std::string_view spec, RecordSchema& out) {
+    RecordSchema s;
+    s.city = s.value = -1;
+    s.fields = 0;
+    while (true) {
+        const std::size_t semi = spec.find(';');
+        const std::string_view name = spec.substr(0, semi);
+        if (s.fields == RecordSchema::kMaxFields) {
+            std::fprintf(stderr, "schema: at most %d fields\n", RecordSchema::kMaxFields);
+            return false;
+        }
+        int* slot = name == "city" || name == "station" ? &s.city
+                  : name == "value"                     ? &s.value
+                  : name == "ts" || name == "time"      ? &s.ts
+                  : nullptr;
+        if (slot && *slot >= 0) {
+            std::fprintf(stderr, "schema: field '%.*s' named twice\n", static_cast<int>(name.size()), name.data());
+            return false;
+        }
+        if (!slot && name != "_") {
+            std::fprintf(stderr, "schema: unknown field '%.*s' (city, ts, value or _)\n", static_cast<int>(name.size()),
+                         name.data());
+            return false;
+        }
+        if (slot) *slot = s.fields;
+        ++s.fields;
+        if (semi == std::string_view::npos) break;
+        spec.remove_prefix(semi + 1);
+    }
+    if (s.city < 0 || s.value < 0) {
+        std::fprintf(stderr, "schema: needs a city and a value field\n");
+        return false;
+    }
+    out = s;
+    return true;
+}
+
+// ---------- Timestamps ----------
+// UTC seconds since the epoch. Input is either an integer ("1700000000",
+// a fraction is dropped) or ISO 8601 "2024-01-31T13:45:00" ('T' or ' '
+// between date and time, optional fraction and trailing 'Z'; the time may be
+// left out for midnight).
+namespace ts_detail {
+
+// Howard Hinnant's days_from_civil / civil_from_days.
+inline std::int64_t days_from_civil(std::int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+inline void civil_from_days(std::int64_t z, std::int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+inline bool digits(const char* p, int n, unsigned& out) {
+    out = 0;
+    for (int i = 0; i < n; ++i) {
+        const unsigned d = static_cast<unsigned char>(p[i]) - '0';
+        if (d > 9) return false;
+        out = out * 10 + d;
+    }
+    return true;
+}
+
+}  // namespace ts_detail
+
+inline bool parse_timestamp(const char* p, const char* e, std::int64_t& secs) {
+    using namespace ts_detail;
+    if (e - p >= 10 && p[4] == '-' && p[7] == '-') {
+        unsigned y, mo, d, h = 0, mi = 0, s = 0;
+        if (!digits(p, 4, y) || !digits(p + 5, 2, mo) || !digits(p + 8, 2, d) || mo - 1 > 11 || d - 1 > 30) return false;
+        const char* q = p + 10;
+        if (q < e && (*q == 'T' || *q == ' ')) {
+            if (e - q < 9 || q[3] != ':' || q[6] != ':' || !digits(q + 1, 2, h) || !digits(q + 4, 2, mi) ||
+                !digits(q + 7, 2, s) || h > 23 || mi > 59 || s > 60) {
+                return false;
+            }
+            q += 9;
+            if (q < e && *q == '.') {
+                ++q;
+                while (q < e && static_cast<unsigned>(*q - '0') <= 9) ++q;
+            }
+        }
+        if (q < e && *q == 'Z') ++q;
+        if (q != e) return false;
+        secs = days_from_civil(y, mo, d) * 86400 + h * 3600 + mi * 60 + s;
+        return true;
+    }
+    const bool neg = p < e && *p == '-';
+    const char* q = p + neg;
+    if (q == e) return false;
+    std::int64_t v = 0;
+    for (; q < e && *q != '.'; ++q) {
+        const unsigned d = static_cast<unsigned char>(*q) - '0';
+        if (d > 9 || v > (std::numeric_limits<std::int64_t>::max() - 9) / 10) return false;
+        v = v * 10 + d;
+    }
+    for (q += q < e; q < e; ++q) {
+        if (static_cast<unsigned>(*q - '0') > 9) return false;
+    }
+    secs = neg ? -v : v;
+    return true;
+}
+
+// Writes "YYYY-MM-DDTHH:MM:SSZ" (20 bytes, no NUL) and returns its length.
+inline std::size_t format_timestamp(std::int64_t secs, char* out) {
+    std::int64_t days = secs / 86400, rem = secs % 86400;
+    if (rem < 0) {
+        rem += 86400;
+        --days;
+    }
+    std::int64_t y;
+    unsigned m, d;
+    ts_detail::civil_from_days(days, y, m, d);
+    char buf[40];
+    const int n = std::snprintf(buf, sizeof buf, "%04lld-%02u-%02uT%02u:%02u:%02uZ", static_cast<long long>(y), m, d,
+                                static_cast<unsigned>(rem / 3600), static_cast<unsigned>(rem / 60 % 60),
+                                static_cast<unsigned>(rem % 60));
+    std::memcpy(out, buf, static_cast<std::size_t>(n));
+    return static_cast<std::size_t>(n);
+}
+
+// "90", "90s", "15m", "1h", "1d" as seconds; 0 when malformed.
+inline std::int64_t parse_duration(std::string_view s) {
+    if (s.empty()) return 0;
+    std::int64_t unit = 1;
+    switch (s.back()) {
+        case 's': unit = 1; s.remove_suffix(1); break;
+        case 'm': unit = 60; s.remove_suffix(1); break;
+        case 'h': unit = 3600; s.remove_suffix(1); break;
+        case 'd': unit = 86400; s.remove_suffix(1); break;
+        default: break;
+    }
+    unsigned long long n = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9' || n > (1ull << 40)) return 0;
+        n = n * 10 + static_cast<unsigned>(c - '0');
+    }
+    return static_cast<std::int64_t>(n) * unit;
+}
+
+// ---------- Record query ----------
+// A schema, the filters every record must pass, and an optional time window
+// to group by. Filters:
+//
+//   station=NAME[,NAME...]   only these stations
+//   value=LO..HI             LO <= value <= HI (either bound may be left out)
+//   ts=FROM..TO              FROM <= ts < TO, as parse_timestamp reads them
+//
+// With a window of W seconds, each station's rows aggregate per window and
+// come out keyed "name;window start" (ISO 8601, UTC), so the result file
+// gains a time column and --sorted lists each station's windows in order.
+struct RecordQuery {
+    RecordSchema schema;
+    std::unordered_set<std::string, SvHash, SvEq> stations;   // empty: all
+    bool         by_station = false;
+    double       value_lo = -std::numeric_limits<double>::infinity();
+    double       value_hi = std::numeric_limits<double>::infinity();
+    bool         by_value = false;
+    std::int64_t ts_from = std::numeric_limits<std::int64_t>::min();
+    std::int64_t ts_to = std::numeric_limits<std::int64_t>::max();
+    bool         by_time = false;
+    std::int64_t window = 0;   // seconds; 0: no grouping
+
+    bool active() const { return !schema.plain() || by_station || by_value || by_time || window; }
+    bool needs_ts() const { return by_time || window; }
+
+    bool add_filter(std::string_view expr) {
+        const std::size_t eq = expr.find('=');
+        const std::string_view key = expr.substr(0, eq == std::string_view::npos ? expr.size() : eq);
+        const std::string_view arg = eq == std::string_view::npos ? std::string_view{} : expr.substr(eq + 1);
+        bool ok = !arg.empty();
+        if (ok && (key == "station" || key == "city")) {
+            by_station = true;
+            for (std::string_view rest = arg;;) {
+                const std::size_t comma = rest.find(',');
+                if (comma != 0) stations.emplace(rest.substr(0, comma));
+                if (comma == std::string_view::npos) break;
+                rest.remove_prefix(comma + 1);
+            }
+        } else if (ok && key == "value") {
+            std::string_view lo, hi;
+            ok = split_range(arg, lo, hi) && (lo.empty() || parse_number(lo, value_lo)) &&
+                 (hi.empty() || parse_number(hi, value_hi));
+            by_value = true;
+        } else if (ok && (key == "ts" || key == "time")) {
+            std::string_view lo, hi;
+            ok = split_range(arg, lo, hi) && (lo.empty() || parse_timestamp(lo.data(), lo.data() + lo.size(), ts_from)) &&
+                 (hi.empty() || parse_timestamp(hi.data(), hi.data() + hi.size(), ts_to));
+            by_time = true;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "filter '%.*s': expected station=A,B | value=LO..HI | ts=FROM..TO\n",
+                         static_cast<int>(expr.size()), expr.data());
+        }
+        return ok;
+    }
+
+    bool set_window(std::string_view s) {
+        window = parse_duration(s);
+        if (window <= 0) std::fprintf(stderr, "window '%.*s': expected e.g. 3600, 15m, 1h or 1d\n",
+                                      static_cast<int>(s.size()), s.data());
+        return window > 0;
+    }
+
+    bool check() const {
+        if (needs_ts() && schema.ts < 0) {
+            std::fprintf(stderr, "time filters and --window need a ts field in --schema (e.g. city;ts;value)\n");
+            return false;
+        }
+        return true;
+    }
+
+    bool want_station(std::string_view s) const { return !by_station || stations.find(s) != stations.end(); }
+    bool want_value(double v) const { return v >= value_lo && v <= value_hi; }
+    bool want_ts(std::int64_t t) const { return t >= ts_from && t < ts_to; }
+
+    // Start of the window holding t (floor, also before 1970).
+    std::int64_t window_of(std::int64_t t) const {
+        const std::int64_t q = t / window;
+        return (q - (t % window < 0)) * window;
+    }
+
+private:
+    static bool split_range(std::string_view arg, std::string_view& lo, std::string_view& hi) {
+        const std::size_t dots = arg.find("..");
+        if (dots == std::string_view::npos) return false;
+        lo = arg.substr(0, dots);
+        hi = arg.substr(dots + 2);
+        return true;
+    }
+    static bool parse_number(std::string_view s, double& out) {
+        const std::string tmp(s);
+        char* end = nullptr;
+        out = std::strtod(tmp.c_str(), &end);
+        return end == tmp.c_str() + tmp.size();
+    }
+};
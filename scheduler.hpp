@@ -0,0 +1,101 @@
+// scheduler.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// ---------- Morsel scheduler ----------
+// Instead of one equal byte range per thread, the input is cut into many
+// small morsels handed out from a shared atomic cursor; a thread that draws a
+// cheap morsel (short names, a cached page run) simply takes the next one, so
+// all threads finish within about one morsel of each other. Morsels are
+// claimed as raw byte ranges [k*M, (k+1)*M) and snapped to line starts by the
+// claiming thread, so nothing is pre-split: a line belongs to the morsel its
+// first byte falls in.
+
+enum class Sched { Static, Morsel };
+
+struct SchedConfig {
+    Sched       mode = Sched::Morsel;
+    bool        report = false;   // per-thread utilization on stderr
+    bool        numa = false;     // per-node slices, pinned workers, node-local tables
+    std::size_t prefetch = 0;     // bytes to touch ahead of the scan (map_tuning.hpp); 0 = off
+};
+
+// First line start at or after pos (a line starts at 0 or after a '\n').
+inline std::size_t line_start_at(const char* data, std::size_t size, std::size_t pos) {
+    if (pos == 0) return 0;
+    if (pos >= size) return size;
+    const void* nl = std::memchr(data + pos - 1, '\n', size - (pos - 1));
+    return nl ? static_cast<std::size_t>(static_cast<const char*>(nl) - data) + 1 : size;
+}
+
+// Morsel size for a range: about 16 per thread, clamped to [1, 16] MiB so
+// small inputs still balance and large ones amortise the claim.
+inline std::size_t morsel_size(std::size_t size, unsigned n_threads) {
+    const std::size_t per = size / (static_cast<std::size_t>(n_threads) * 16);
+    return std::clamp<std::size_t>(per, std::size_t{1} << 20, std::size_t{16} << 20);
+}
+
+class MorselCursor {
+public:
+    MorselCursor(const char* data, std::size_t size, std::size_t morsel)
+        : data_(data), size_(size), morsel_(morsel) {}
+
+    // Claims the next morsel; false once the input is drained.
+    bool next(std::string_view& out) {
+        for (;;) {
+            const std::size_t k = next_.fetch_add(1, std::memory_order_relaxed);
+            const std::size_t lo = k * morsel_;
+            if (lo >= size_) return false;
+            const std::size_t begin = line_start_at(data_, size_, lo);
+            const std::size_t end = line_start_at(data_, size_, std::min(size_, lo + morsel_));
+            if (end <= begin) continue;   // a line longer than the morsel swallowed it
+            out = std::string_view(data_ + begin, end - begin);
+            return true;
+        }
+    }
+
+    std::size_t morsel() const { return morsel_; }
+
+    // Bytes handed out so far (the claim front, not what has been parsed).
+    std::size_t claimed() const {
+        return std::min(size_, next_.load(std::memory_order_relaxed) * morsel_);
+    }
+
+private:
+    const char*              data_;
+    std::size_t              size_;
+    std::size_t              morsel_;
+    std::atomic<std::size_t> next_{0};
+};
+
+// ---------- Utilization report ----------
+struct WorkerStats {
+    std::uint64_t morsels = 0;
+    std::uint64_t bytes = 0;
+    double        busy_ms = 0.0;   // time spent parsing
+    double        done_ms = 0.0;   // when the thread ran out of work, from scan start
+};
+
+inline void report_utilization(FILE* fp, const char* label, const std::vector<WorkerStats>& ws, double wall_ms) {
+    if (ws.empty()) return;
+    std::fprintf(fp, "sched: %s, %zu threads, wall %.1f ms\n", label, ws.size(), wall_ms);
+    std::fprintf(fp, "  %6s %8s %10s %10s %10s %7s\n", "thread", "morsels", "MB", "busy_ms", "done_ms", "util");
+    double first = ws[0].done_ms, last = ws[0].done_ms, util = 0.0;
+    for (std::size_t t = 0; t < ws.size(); ++t) {
+        const WorkerStats& w = ws[t];
+        const double u = wall_ms > 0 ? 100.0 * w.busy_ms / wall_ms : 0.0;
+        std::fprintf(fp, "  %6zu %8llu %10.1f %10.1f %10.1f %6.1f%%\n", t, static_cast<unsigned long long>(w.morsels),
+                     static_cast<double>(w.bytes) / 1e6, w.busy_ms, w.done_ms, u);
+        first = std::min(first, w.done_ms);
+        last = std::max(last, w.done_ms);
+        util += u;
+    }
+    std::fprintf(fp, "  tail: first thread idle at %.1f ms, last at %.1f ms (spread %.1f ms), mean util %.1f%%\n",
+                 first, last, last - first, util / static_cast<double>(ws.size()));
+}
@@ -1,130 +1,1434 @@
 // solution.cpp
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
 #include <string_view>
-#include <unordered_map>
-#include <limits>
 #include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "checkpoint.hpp"
+#include "columnar.hpp"
+#include "compressed_input.hpp"
+#include "delim_scan.hpp"
+#include "extended_stats.hpp"
+#include "file_set.hpp"
+#include "format_results.hpp"
+#include "io_backend.hpp"
+#include "map_tuning.hpp"
+#include "numa.hpp"
+#include "parse_value.hpp"
+#include "perfect_hash.hpp"
+#include "query_server.hpp"
+#include "record_filter.hpp"
+#include "scheduler.hpp"
+#include "station_table.hpp"
+
+using CityMap = StationTable<DefaultHash, DefaultResult>;   // CityResult<> unless built with BRC_STATS
+
+// ---------- Memory-mapped input ----------
+// Maps [from, EOF) of a file, with `from` rounded down to a page boundary, so
+// an incremental run only touches the pages it is about to scan. MapOptions
+// picks MAP_POPULATE and the madvise hints.
+struct MappedFile {
+    const char* map = nullptr;
+    size_t      map_len = 0;
+    uint64_t    map_off = 0;    // file offset of map[0]
+    uint64_t    file_size = 0;
+
+    bool open(const char* path, uint64_t from = 0, const MapOptions& mo = {}) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) { std::perror("open"); return false; }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) { std::perror("fstat"); ::close(fd); return false; }
+        file_size = static_cast<uint64_t>(st.st_size);
+        const uint64_t page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+        map_off = (from < file_size ? from : file_size) / page * page;
+        map_len = static_cast<size_t>(file_size - map_off);
+        if (map_len == 0) { ::close(fd); return true; }
+        void* p = ::mmap(nullptr, map_len, PROT_READ, map_flags(mo), fd, static_cast<off_t>(map_off));
+        ::close(fd);  // the mapping keeps its own reference
+        if (p == MAP_FAILED) { std::perror("mmap"); map_len = 0; return false; }
+        apply_madvise(p, map_len, mo);
+        map = static_cast<const char*>(p);
+        return true;
+    }
+
+    const char* at(uint64_t off) const { return map + (off - map_off); }
+
+    void close() {
+        if (map) ::munmap(const_cast<char*>(map), map_len);
+        map = nullptr;
+        map_len = 0;
+    }
+
+    ~MappedFile() { close(); }
+};
+
+// ---------- Chunking ----------
+// Split [data, data+size) into n ranges whose boundaries sit just after a '\n',
+// so every record belongs to exactly one chunk.
+static std::vector<std::string_view> split_chunks(const char* data, size_t size, unsigned n) {
+    std::vector<std::string_view> chunks;
+    const char* end = data + size;
+    const char* begin = data;
+    for (unsigned i = 1; i <= n && begin < end; ++i) {
+        const char* cut = (i == n) ? end : data + size / n * i;
+        if (cut < begin) cut = begin;
+        if (cut < end) {
+            const char* nl = static_cast<const char*>(std::memchr(cut, '\n', static_cast<size_t>(end - cut)));
+            cut = nl ? nl + 1 : end;
+        }
+        if (cut > begin) chunks.emplace_back(begin, static_cast<size_t>(cut - begin));
+        begin = cut;
+    }
+    return chunks;
+}
+
+// ---------- Record decoding ----------
+// Parses the value in [val, le) straight from the mapping (no copy, no NUL
+// needed). `limit` is the end of readable memory, used to decide whether the
+// 8-byte SWAR load is safe.
+static inline bool decode_value(const char* val, const char* le, const char* limit, double& v) {
+    if (is_fixed1(val, le) && val + 8 <= limit) {
+        const char* e;
+        v = parse_fixed1_swar(val, &e) / 10.0;
+        return true;
+    }
+    return parse_double(val, le, v) != nullptr;
+}
+
+// Splits one line into city and value.
+static inline bool decode_record(const char* line, const char* sep, const char* le,
+                                 const char* limit, std::string_view& city, double& v) {
+    // Trim trailing '\r'
+    while (le > line && le[-1] == '\r') --le;
+    if (!sep || sep + 1 >= le) return false;
+
+    city = std::string_view{line, static_cast<size_t>(sep - line)};
+    return decode_value(sep + 1, le, limit, v);
+}
+
+// ---------- Scan kernels ----------
+// A kernel aggregates one chunk into a thread-local table. scan_kernel is
+// specialized at compile time on
+//   Value   FixedValue<N>: values are exactly "-?\d+\.\d{N}", parsed to
+//           integer units that the default MixedSum (or a FixedSum) adds
+//           exactly;
+//           AnyValue: whatever decode_record accepts.
+//   MaxKey  16: names fit the first hash block and the slot prefix, so a hit
+//           is two word compares (upsert_short); 0: any length.
+// The accumulator comes in through CityMap's result type. A record that
+// breaks the kernel's assumptions goes through the generic path, and marks the
+// run so that every chunk started afterwards uses the generic kernel.
+// probe_kernel picks the instantiation from the first few MB of input.
+using KernelFn = void (*)(ScanBlocksFn scan, std::string_view chunk, CityMap& results);
+
+struct ScanKernel {
+    KernelFn    fn;
+    const char* name;
+    const ScanKernel* broken = nullptr;   // once a record broke the format; null: the generic kernel
+};
+
+struct AnyValue {
+    static bool decode(const char* line, const char* sep, const char* le, const char* limit,
+                       std::string_view& city, double& v, int64_t&) {
+        return decode_record(line, sep, le, limit, city, v);
+    }
+    static void update(CityMap::result_type& r, double v, int64_t) { r.update(v); }
+    static void update_block(CityMap::result_type& r, const double* v, const int64_t*, size_t n) { r.update_block(v, n); }
+};
 
-// ---------- City stats ----------
-struct CityResult {
-    double min  =  std::numeric_limits<double>::infinity();
-    double max  = -std::numeric_limits<double>::infinity();
-    int    counter = 0;
-    double sum  = 0.0;
+template <int N>
+struct FixedValue {
+    static bool decode(const char* line, const char* sep, const char* le, const char* limit,
+                       std::string_view& city, double& v, int64_t& units) {
+        if (!sep) return false;
+        city = std::string_view{line, static_cast<size_t>(sep - line)};
+        const char* val = sep + 1;
+        if constexpr (N == 1) {
+            if (is_fixed1(val, le) && val + 8 <= limit) {   // as in decode_record
+                const char* e;
+                units = parse_fixed1_swar(val, &e);
+                v = static_cast<double>(units) / 10.0;
+                return true;
+            }
+        }
+        return parse_fixed<N>(val, le, units, v);
+    }
+    static void update(CityMap::result_type& r, double v, int64_t units) { r.template update_units<N>(v, units); }
+    static void update_block(CityMap::result_type& r, const double* v, const int64_t* units, size_t n) {
+        r.template update_units_block<N>(v, units, n);
+    }
 };
 
-// ---------- Transparent hash/equal for heterogenous lookup ----------
-struct SvHash {
-    using is_transparent = void;  // enables heterogenous lookup
-    std::size_t operator()(std::string_view s) const noexcept {
-        // FNV-1a 64-bit
-        std::uint64_t h = 1469598103934665603ull;
-        for (unsigned char c : s) {
-            h ^= c;
-            h *= 1099511628211ull;
+static std::atomic<bool>     g_kernel_broken{false};   // a record broke the probed format
+static std::atomic<uint64_t> g_kernel_fallbacks{0};
+
+static void generic_record(const char* line, const char* sep, const char* le, const char* limit, CityMap& results) {
+    std::string_view city_sv;
+    double v;
+    if (!decode_record(line, sep, le, limit, city_sv, v)) return;
+
+    // Probe without allocation; the key is copied only on first sight.
+    // The key is still in the chunk, so the hash may load past its end.
+    results.upsert(city_sv, CityMap::hash_of(city_sv, limit)).update(v);
+}
+
+// Map is always CityMap; as a template parameter it keeps the upsert_short
+// branch from being checked for result types whose slots have no room for it.
+template <size_t MaxKey, class Map>
+static inline typename Map::result_type& find_slot(std::string_view city, const char* limit, Map& results) {
+    if constexpr (MaxKey != 0 && MaxKey <= 16 && Map::Slot::kPrefix >= 16 && BlockHash<DefaultHash>) {
+        const char* line = city.data();
+        if (line + 16 <= limit) {
+            using namespace hash_detail;
+            const uint64_t w0 = low_bytes(load8(line), city.size());
+            const uint64_t w1 = city.size() > 8 ? low_bytes(load8(line + 8), city.size() - 8) : 0;
+            const uint64_t h = Map::stored_hash(DefaultHash::words(w0, w1, line, city.size()));
+            return results.upsert_short(city, h, w0, w1);
         }
-        return static_cast<std::size_t>(h);
     }
+    return results.upsert(city, Map::hash_of(city, limit));
+}
+
+// Decodes a record and checks it against the kernel's assumptions.
+template <class Value, size_t MaxKey>
+static inline bool fast_decode(const char* line, const char* sep, const char* le, const char* limit,
+                               std::string_view& city, double& v, int64_t& units) {
+    if (!Value::decode(line, sep, le, limit, city, v, units)) return false;
+    if constexpr (MaxKey != 0) {
+        if (city.size() > MaxKey) return false;
+    }
+    return true;
+}
+
+template <class Value, size_t MaxKey, class Map>
+static inline bool fast_record(const char* line, const char* sep, const char* le, const char* limit, Map& results) {
+    std::string_view city;
+    double v;
+    int64_t units = 0;
+    if (!fast_decode<Value, MaxKey>(line, sep, le, limit, city, v, units)) return false;
+    Value::update(find_slot<MaxKey>(city, limit, results), v, units);
+    return true;
+}
+
+template <class Value, size_t MaxKey>
+static void scan_kernel(ScanBlocksFn scan, std::string_view chunk, CityMap& results) {
+    const char* chunk_end = chunk.data() + chunk.size();
+    uint64_t fallbacks = 0;
+    for_each_record(scan, chunk.data(), chunk.size(),
+                    [&](const char* line, const char* sep, const char* le) {
+        if constexpr (!std::is_same_v<Value, AnyValue> || MaxKey != 0) {
+            if (fast_record<Value, MaxKey>(line, sep, le, chunk_end, results)) return;
+            ++fallbacks;
+        }
+        generic_record(line, sep, le, chunk_end, results);
+    });
+    if (fallbacks) {
+        g_kernel_fallbacks.fetch_add(fallbacks, std::memory_order_relaxed);
+        g_kernel_broken.store(true, std::memory_order_relaxed);
+    }
+}
+
+// ---------- Run batching ----------
+// Sorted or clustered input repeats a station for many rows. run_kernel
+// checks each name against the previous row's before hashing it, so a repeat
+// skips the lookup, and collects the run's values into a block that
+// update_block reduces with vector min/max and independent sum chains
+// instead of one dependent update per row. probe_kernel picks it when the
+// probed rows average kMinRun or more per run; shuffled input keeps
+// scan_kernel, whose per-row update is branchless.
+static constexpr double kMinRun = 4.0;
+
+template <class Value>
+struct RunBatch {
+    static constexpr size_t kBlock = 64;
+
+    CityMap::result_type* slot = nullptr;   // station of the run; no other upsert until flush()
+    std::string_view      name;
+    size_t                n = 0;
+    alignas(64) double    v[kBlock];
+    alignas(64) int64_t   units[kBlock];
+
+    void push(double x, int64_t u) {
+        v[n] = x;
+        units[n] = u;
+        if (++n == kBlock) flush();
+    }
+    void flush() {
+        if (n == 1) Value::update(*slot, v[0], units[0]);
+        else if (n) Value::update_block(*slot, v, units, n);
+        n = 0;
+    }
+    void end() {
+        flush();
+        slot = nullptr;
+        name = {};
+    }
+    // Whether city is the run's station. Names are compared in place: both
+    // still point into the chunk.
+    bool same(std::string_view city, const char* limit) const {
+        if (city.size() != name.size() || !slot) return false;
+        if (city.size() <= 16 && city.data() + 16 <= limit) {   // name is earlier in the chunk
+            using namespace hash_detail;
+            const size_t len = city.size();
+            const uint64_t a0 = load8(city.data()), b0 = load8(name.data());
+            const uint64_t a1 = len > 8 ? load8(city.data() + 8) : 0, b1 = len > 8 ? load8(name.data() + 8) : 0;
+            return low_bytes(a0 ^ b0, len) == 0 && (len <= 8 || low_bytes(a1 ^ b1, len - 8) == 0);
+        }
+        return std::memcmp(city.data(), name.data(), city.size()) == 0;
+    }
+};
+
+template <class Value, size_t MaxKey>
+static void run_kernel(ScanBlocksFn scan, std::string_view chunk, CityMap& results) {
+    const char* chunk_end = chunk.data() + chunk.size();
+    RunBatch<Value> run;
+    uint64_t fallbacks = 0;
+    for_each_record(scan, chunk.data(), chunk.size(),
+                    [&](const char* line, const char* sep, const char* le) {
+        std::string_view city;
+        double v;
+        int64_t units = 0;
+        if (!fast_decode<Value, MaxKey>(line, sep, le, chunk_end, city, v, units)) {
+            if constexpr (!std::is_same_v<Value, AnyValue> || MaxKey != 0) ++fallbacks;
+            run.end();   // generic_record may grow the table under the slot
+            generic_record(line, sep, le, chunk_end, results);
+            return;
+        }
+        if (!run.same(city, chunk_end)) {
+            run.end();
+            run.slot = &find_slot<MaxKey>(city, chunk_end, results);
+            run.name = city;
+        }
+        run.push(v, units);
+    });
+    run.end();
+    if (fallbacks) {
+        g_kernel_fallbacks.fetch_add(fallbacks, std::memory_order_relaxed);
+        g_kernel_broken.store(true, std::memory_order_relaxed);
+    }
+}
+
+static constexpr ScanKernel kGenericKernel = {scan_kernel<AnyValue, 0>, "generic"};
+static ScanKernel g_kernel = kGenericKernel;   // set before the workers start
+
+// ---------- Filtered scan ----------
+// With a schema other than city;value, any filter or a time window, every
+// chunk goes through query_kernel instead. Fields are split per the schema
+// and the filters run cheapest first (timestamp, station, value) before
+// anything is hashed, so a rejected row costs a few compares and never
+// touches the table. A windowed row is keyed "name;window start", the label
+// formatted once per window change rather than per row.
+static RecordQuery           g_query;            // set before the workers start
+static bool                  g_query_on = false;
+static std::atomic<uint64_t> g_query_rows{0};
+static std::atomic<uint64_t> g_query_kept{0};
+
+struct QueryScratch {
+    std::string key;
+    int64_t     window = INT64_MIN;   // window of label
+    char        label[32];
+    size_t      label_len = 0;
+};
+
+static inline bool query_record(const char* line, const char* sep, const char* le, const char* limit,
+                                CityMap& results, QueryScratch& qs) {
+    while (le > line && le[-1] == '\r') --le;
+    if (!sep || sep > le) return false;
+    const RecordSchema& sc = g_query.schema;
+    const char* begin[RecordSchema::kMaxFields];
+    const char* end[RecordSchema::kMaxFields];
+    begin[0] = line;
+    end[0] = sep;
+    for (int f = 1, need = sc.last_needed(); f <= need; ++f) {
+        if (end[f - 1] == le) return false;   // too few fields
+        begin[f] = end[f - 1] + 1;
+        const void* semi = std::memchr(begin[f], ';', static_cast<size_t>(le - begin[f]));
+        end[f] = semi ? static_cast<const char*>(semi) : le;
+    }
+
+    int64_t ts = 0;
+    if (g_query.needs_ts() && (!parse_timestamp(begin[sc.ts], end[sc.ts], ts) || !g_query.want_ts(ts))) return false;
+    const std::string_view city(begin[sc.city], static_cast<size_t>(end[sc.city] - begin[sc.city]));
+    if (city.empty() || !g_query.want_station(city)) return false;
+    double v;
+    if (end[sc.value] == begin[sc.value] || !decode_value(begin[sc.value], end[sc.value], limit, v) ||
+        !g_query.want_value(v)) {
+        return false;
+    }
+
+    if (!g_query.window) {
+        results.upsert(city, CityMap::hash_of(city, limit)).update(v);
+        return true;
+    }
+    const int64_t w = g_query.window_of(ts);
+    if (w != qs.window) {
+        qs.window = w;
+        qs.label_len = format_timestamp(w, qs.label);
+    }
+    qs.key.assign(city);
+    qs.key += ';';
+    qs.key.append(qs.label, qs.label_len);
+    const std::string_view key = qs.key;
+    results.upsert(key, CityMap::hash_of(key, key.data() + key.size())).update(v);
+    return true;
+}
+
+static void query_kernel(ScanBlocksFn scan, std::string_view chunk, CityMap& results) {
+    const char* chunk_end = chunk.data() + chunk.size();
+    QueryScratch qs;
+    uint64_t rows = 0, kept = 0;
+    for_each_record(scan, chunk.data(), chunk.size(), [&](const char* line, const char* sep, const char* le) {
+        ++rows;
+        kept += query_record(line, sep, le, chunk_end, results, qs);
+    });
+    g_query_rows.fetch_add(rows, std::memory_order_relaxed);
+    g_query_kept.fetch_add(kept, std::memory_order_relaxed);
+}
+
+static void process_chunk(ScanBlocksFn scan, std::string_view chunk, CityMap& results) {
+    if (g_query_on) {
+        query_kernel(scan, chunk, results);
+        return;
+    }
+    const KernelFn fn = !g_kernel_broken.load(std::memory_order_relaxed) ? g_kernel.fn
+                        : g_kernel.broken                                 ? g_kernel.broken->fn
+                                                                          : kGenericKernel.fn;
+    fn(scan, chunk, results);
+}
+
+// ---------- Dictionary scan ----------
+// For a known station list (--dict): names resolve through a minimal perfect
+// hash to a dense index, and rows accumulate into a flat per-thread array of
+// results instead of the open-addressing table. The stations a chunk touched
+// are folded into the chunk's table once at its end, so everything after
+// the kernel (merges, output, checkpoints) is unchanged. Names outside the
+// list go to the table as before. dict_kernel takes the place of the probed
+// kernel, keeping its value specialization.
+static StationDictionary     g_dict;             // empty: off; set before the workers start
+static std::vector<uint64_t> g_dict_hash;        // CityMap::hash_of each dictionary name
+static bool                  g_dict_sample = false;   // build g_dict from the probed head
+static std::atomic<uint64_t> g_dict_misses{0};
+
+static bool set_dictionary(const std::vector<std::string_view>& names) {
+    if (!g_dict.build(names)) return false;
+    g_dict_hash.resize(g_dict.size());
+    for (uint32_t i = 0; i < g_dict.size(); ++i) g_dict_hash[i] = CityMap::hash_of(g_dict.name(i));
+    return true;
+}
+
+// With Runs, a run of one station batches into its dense entry (or, for a
+// name outside the list, its table slot) as in run_kernel.
+template <class Value, bool Runs>
+static void dict_kernel(ScanBlocksFn scan, std::string_view chunk, CityMap& results) {
+    thread_local std::vector<CityMap::result_type> dense;
+    thread_local std::vector<uint32_t> touched;
+    if (dense.size() != g_dict.size()) dense.assign(g_dict.size(), CityMap::result_type{});
+
+    const char* chunk_end = chunk.data() + chunk.size();
+    RunBatch<Value> run;
+    bool run_missed = false;   // the run's station is outside the list
+    uint64_t misses = 0, fallbacks = 0;
+    for_each_record(scan, chunk.data(), chunk.size(),
+                    [&](const char* line, const char* sep, const char* le) {
+        std::string_view city;
+        double v;
+        int64_t units = 0;
+        if (!Value::decode(line, sep, le, chunk_end, city, v, units)) {
+            if constexpr (!std::is_same_v<Value, AnyValue>) ++fallbacks;
+            if constexpr (Runs) run.end();
+            generic_record(line, sep, le, chunk_end, results);
+            return;
+        }
+        if constexpr (Runs) {
+            if (run.same(city, chunk_end)) {
+                misses += run_missed;
+                run.push(v, units);
+                return;
+            }
+            run.end();
+        }
+        const uint32_t i = g_dict.find(city.data(), city.size(), chunk_end);
+        if (i == StationDictionary::kMiss) ++misses;
+        CityMap::result_type& r = i == StationDictionary::kMiss ? results.upsert(city, CityMap::hash_of(city, chunk_end))
+                                                                : dense[i];
+        if (i != StationDictionary::kMiss && r.count() == 0) touched.push_back(i);
+        if constexpr (Runs) {
+            run_missed = i == StationDictionary::kMiss;
+            run.slot = &r;
+            run.name = city;
+            run.push(v, units);
+        } else {
+            Value::update(r, v, units);
+        }
+    });
+    if constexpr (Runs) run.end();
+    for (uint32_t i : touched) {
+        results.upsert(g_dict.name(i), g_dict_hash[i]).merge(dense[i]);
+        dense[i] = CityMap::result_type{};
+    }
+    touched.clear();
+    if (misses) g_dict_misses.fetch_add(misses, std::memory_order_relaxed);
+    if (fallbacks) {
+        g_kernel_fallbacks.fetch_add(fallbacks, std::memory_order_relaxed);
+        g_kernel_broken.store(true, std::memory_order_relaxed);
+    }
+}
+
+// What the first kProbeBytes (cut at a line end) of a range look like.
+struct KernelProbe {
+    size_t   bytes = 0;
+    uint64_t records = 0;
+    int      decimals = 0;      // N if every value is fixed N-decimal (N <= 2), else 0
+    size_t   max_key = 0;
+    uint64_t runs = 0;          // maximal runs of one station
+
+    double mean_run() const { return runs ? static_cast<double>(records) / static_cast<double>(runs) : 0.0; }
+};
+
+static constexpr size_t kProbeBytes = 4 << 20;
+
+// Distinct station names in kProbeBytes of [data, data+size), read as 64
+// slices spread over it so that sorted input still shows more than its first
+// stations. Empty when there are more than a dictionary is worth.
+static std::vector<std::string_view> sample_names(ScanBlocksFn scan, const char* data, size_t size) {
+    constexpr size_t kSlices = 64, kMaxNames = 1 << 16;
+    std::unordered_set<std::string_view> seen;
+    for (size_t k = 0; k < kSlices && seen.size() <= kMaxNames; ++k) {
+        const size_t begin = line_start_at(data, size, size / kSlices * k);
+        const size_t end = line_start_at(data, size, std::min(size, begin + kProbeBytes / kSlices));
+        for_each_record(scan, data + begin, end - begin, [&](const char* line, const char* sep, const char*) {
+            if (sep) seen.emplace(line, static_cast<size_t>(sep - line));
+        });
+    }
+    if (seen.size() > kMaxNames) return {};
+    return std::vector<std::string_view>(seen.begin(), seen.end());
+}
+
+static ScanKernel probe_kernel(ScanBlocksFn scan, const char* data, size_t size, KernelProbe& pr) {
+    pr = KernelProbe{};
+    if (g_query_on) return kGenericKernel;   // query_kernel takes every chunk
+    pr.bytes = std::min(size, kProbeBytes);
+    if (pr.bytes < size) {
+        const void* nl = ::memrchr(data, '\n', pr.bytes);
+        if (nl) pr.bytes = static_cast<size_t>(static_cast<const char*>(nl) - data) + 1;
+    }
+    bool fixed = true;
+    std::string_view prev;
+    for_each_record(scan, data, pr.bytes, [&](const char* line, const char* sep, const char* le) {
+        ++pr.records;
+        if (!sep) {
+            fixed = false;
+            ++pr.runs;
+            prev = {};
+            return;
+        }
+        const std::string_view city{line, static_cast<size_t>(sep - line)};
+        if (city != prev || !prev.data()) ++pr.runs;
+        prev = city;
+        pr.max_key = std::max(pr.max_key, city.size());
+        if (!fixed) return;
+        const char* dot = static_cast<const char*>(std::memchr(sep + 1, '.', static_cast<size_t>(le - sep - 1)));
+        const int d = dot ? static_cast<int>(le - dot - 1) : 0;
+        if (pr.decimals == 0) pr.decimals = d;
+        int64_t units;
+        double v;
+        fixed = d == pr.decimals && (d == 1   ? parse_fixed<1>(sep + 1, le, units, v)
+                                     : d == 2 ? parse_fixed<2>(sep + 1, le, units, v)
+                                              : false);
+    });
+    if (!fixed || pr.records == 0) pr.decimals = 0;
+
+    if (g_dict_sample && g_dict.empty() && !set_dictionary(sample_names(scan, data, size))) {
+        std::fprintf(stderr, "dict: no dictionary from the sample (none, or over 65536 names); using the table\n");
+    }
+    g_dict_sample = false;   // once per run, also in --follow
+    const int runs = pr.mean_run() >= kMinRun ? 1 : 0;
+    // A specialized kernel that breaks falls back to the format-agnostic
+    // kernel of its family, so a dictionary run keeps its dictionary.
+    static constexpr ScanKernel kDict = {dict_kernel<AnyValue, false>, "dict"};
+    static constexpr ScanKernel kDictRuns = {dict_kernel<AnyValue, true>, "dict/runs"};
+    static constexpr ScanKernel kRuns = {run_kernel<AnyValue, 0>, "any/runs"};
+    static constexpr ScanKernel kDictKernels[3][2] = {
+        {kDict, kDictRuns},
+        {{dict_kernel<FixedValue<1>, false>, "fixed1/dict", &kDict}, {dict_kernel<FixedValue<1>, true>, "fixed1/dict/runs", &kDictRuns}},
+        {{dict_kernel<FixedValue<2>, false>, "fixed2/dict", &kDict}, {dict_kernel<FixedValue<2>, true>, "fixed2/dict/runs", &kDictRuns}},
+    };
+    if (!g_dict.empty()) return kDictKernels[pr.decimals][runs];
+
+    static constexpr ScanKernel kKernels[3][2][2] = {
+        {{kGenericKernel, kRuns},
+         {{scan_kernel<AnyValue, 16>, "any/key16"}, {run_kernel<AnyValue, 16>, "any/key16/runs", &kRuns}}},
+        {{{scan_kernel<FixedValue<1>, 0>, "fixed1"}, {run_kernel<FixedValue<1>, 0>, "fixed1/runs", &kRuns}},
+         {{scan_kernel<FixedValue<1>, 16>, "fixed1/key16"}, {run_kernel<FixedValue<1>, 16>, "fixed1/key16/runs", &kRuns}}},
+        {{{scan_kernel<FixedValue<2>, 0>, "fixed2"}, {run_kernel<FixedValue<2>, 0>, "fixed2/runs", &kRuns}},
+         {{scan_kernel<FixedValue<2>, 16>, "fixed2/key16"}, {run_kernel<FixedValue<2>, 16>, "fixed2/key16/runs", &kRuns}}},
+    };
+    // key16 needs a 16-byte slot prefix, which a wider accumulator takes
+    constexpr bool kKey16 = CityMap::Slot::kPrefix >= 16;
+    return kKernels[pr.decimals][kKey16 && pr.records && pr.max_key <= 16 ? 1 : 0][runs];
+}
+
+// ---------- Parallel scan of one byte range ----------
+// Morsel mode (the default) hands out small line-aligned pieces from an atomic
+// cursor; static mode is the old one-range-per-thread split, kept for
+// comparison. Partials merge in thread order, sharded across the threads.
+// Which morsels a thread parsed depends on timing. That leaves sums of
+// fixed-decimal input unchanged (the default MixedSum keeps them as exact
+// integers) but can move the last bits of a double sum between runs.
+static void aggregate_numa(ScanBlocksFn scan, const char* data, size_t size, const SchedConfig& sc, CityMap& results);
+
+static void aggregate_range(ScanBlocksFn scan, const char* data, size_t size,
+                            unsigned n_threads, const SchedConfig& sc, CityMap& results) {
+    // Small appends are not worth waking every core for
+    const size_t min_chunk = 1 << 20;
+    unsigned n = n_threads;
+    if (size / min_chunk + 1 < n) n = static_cast<unsigned>(size / min_chunk + 1);
+    if (n <= 1) {
+        process_chunk(scan, std::string_view(data, size), results);
+        return;
+    }
+    if (sc.numa) {
+        aggregate_numa(scan, data, size, sc, results);
+        return;
+    }
+
+    std::vector<CityMap> partials;
+    partials.reserve(n);
+    for (unsigned i = 0; i < n; ++i) partials.emplace_back(1 << 12);
+    std::vector<WorkerStats> stats(n);
+
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    auto ms_since = [](clock::time_point a, clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+
+    std::vector<std::string_view> chunks;
+    MorselCursor cursor(data, size, morsel_size(size, n));
+    if (sc.mode == Sched::Static) chunks = split_chunks(data, size, n);
+
+    // Static threads each walk their own range, so there is no single front
+    // to pace against; the prefetcher then just runs through the input.
+    std::optional<Prefetcher> prefetch;
+    if (sc.prefetch) {
+        prefetch.emplace(data, size, sc.prefetch, [&cursor, &sc, size] {
+            return sc.mode == Sched::Morsel ? cursor.claimed() : size;
+        });
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(n);
+    for (unsigned i = 0; i < n; ++i) {
+        workers.emplace_back([&, i] {
+            WorkerStats& ws = stats[i];
+            auto run = [&](std::string_view piece) {
+                const auto a = clock::now();
+                process_chunk(scan, piece, partials[i]);
+                ws.busy_ms += ms_since(a, clock::now());
+                ++ws.morsels;
+                ws.bytes += piece.size();
+            };
+            if (sc.mode == Sched::Static) {
+                if (i < chunks.size()) run(chunks[i]);
+            } else {
+                std::string_view piece;
+                while (cursor.next(piece)) run(piece);
+            }
+            ws.done_ms = ms_since(t0, clock::now());
+        });
+    }
+    for (auto& t : workers) t.join();
+    const auto t1 = clock::now();
+    prefetch.reset();
+
+    results.merge_parallel(partials, n);
+
+    if (sc.report) {
+        char label[64];
+        if (sc.mode == Sched::Static) std::snprintf(label, sizeof label, "static split");
+        else std::snprintf(label, sizeof label, "morsel (%.1f MiB)", static_cast<double>(cursor.morsel()) / (1 << 20));
+        report_utilization(stderr, label, stats, ms_since(t0, t1));
+        std::fprintf(stderr, "  merge: %u tables into %zu stations in %.1f ms\n", n, results.size(), ms_since(t1, clock::now()));
+    }
+}
+
+// ---------- NUMA-aware scan ----------
+// One contiguous slice of the input per node, sized by its CPU count. A
+// leader thread per node pins itself to the node's CPUs and prefers the
+// node's memory; the workers it spawns inherit both, so the page-cache pages
+// they fault in and the station tables they build (first touch) are local.
+// Each node balances its slice with its own morsel cursor, merges its
+// workers' tables on the node, and the per-node tables merge at the end.
+// --sched-report adds the per-node timing and local/remote load counts.
+static void aggregate_numa(ScanBlocksFn scan, const char* data, size_t size, const SchedConfig& sc, CityMap& results) {
+    const std::vector<NumaNode> nodes = numa_nodes();
+    const size_t n_nodes = nodes.size();
+    size_t total_cpus = 0;
+    for (const NumaNode& nd : nodes) total_cpus += nd.cpus.size();
+
+    std::vector<size_t> bounds(n_nodes + 1, 0);
+    size_t cpus_before = 0;
+    for (size_t j = 0; j < n_nodes; ++j) {
+        cpus_before += nodes[j].cpus.size();
+        bounds[j + 1] = j + 1 == n_nodes ? size
+                      : line_start_at(data, size, static_cast<size_t>(static_cast<double>(size) * cpus_before / total_cpus));
+    }
+
+    NodeAccessCounters counters;
+    const bool have_counters = sc.report && counters.start();
+
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    std::vector<CityMap> node_tables;
+    node_tables.reserve(n_nodes);
+    for (size_t j = 0; j < n_nodes; ++j) node_tables.emplace_back(16);
+    std::vector<double> node_ms(n_nodes, 0.0);
+    std::vector<int> pinned(n_nodes, 0);
+
+    std::vector<std::thread> leaders;
+    for (size_t j = 0; j < n_nodes; ++j) {
+        leaders.emplace_back([&, j] {
+            const NumaNode& nd = nodes[j];
+            pinned[j] = pin_to_cpus(nd.cpus);
+            prefer_node(nd.id);
+
+            const unsigned n = static_cast<unsigned>(nd.cpus.size());
+            const char* slice = data + bounds[j];
+            const size_t slice_len = bounds[j + 1] - bounds[j];
+            MorselCursor cursor(slice, slice_len, morsel_size(slice_len, n));
+            std::vector<CityMap> partials;      // placeholders; each worker builds its own
+            partials.reserve(n);
+            for (unsigned i = 0; i < n; ++i) partials.emplace_back(16);
+            std::vector<std::thread> workers;
+            for (unsigned i = 0; i < n; ++i) {
+                workers.emplace_back([&, i] {
+                    partials[i] = CityMap(1 << 12);
+                    std::string_view piece;
+                    while (cursor.next(piece)) process_chunk(scan, piece, partials[i]);
+                });
+            }
+            for (auto& t : workers) t.join();
+            node_tables[j] = CityMap(1 << 12);
+            node_tables[j].merge_parallel(partials, n);
+            node_ms[j] = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+        });
+    }
+    for (auto& t : leaders) t.join();
+    results.merge_parallel(node_tables, static_cast<unsigned>(total_cpus));
+    if (!sc.report) return;
+
+    std::fprintf(stderr, "numa: %zu node(s), %.1f ms\n", n_nodes,
+                 std::chrono::duration<double, std::milli>(clock::now() - t0).count());
+    for (size_t j = 0; j < n_nodes; ++j) {
+        std::fprintf(stderr, "  node %d: %zu cpus%s, %.1f MB, done at %.1f ms\n", nodes[j].id, nodes[j].cpus.size(),
+                     pinned[j] ? "" : " (unpinned)", static_cast<double>(bounds[j + 1] - bounds[j]) / 1e6, node_ms[j]);
+    }
+    double local, remote;
+    if (have_counters && counters.read(local, remote) && local + remote > 0) {
+        std::fprintf(stderr, "  memory loads: %.0f local, %.0f remote (%.1f%% local)\n", local, remote,
+                     100.0 * local / (local + remote));
+    } else {
+        std::fprintf(stderr, "  memory loads: node counters unavailable\n");
+    }
+}
+
+// ---------- Streaming scan of one byte range ----------
+// Same aggregation over a ChunkPipeline instead of a mapping. Worker w parses
+// chunks w, w + n, w + 2n, ... so each partial table sees a fixed sequence and
+// the merge stays deterministic. A worker only parses the complete lines of
+// its chunk; the partial line at each end is kept, and the lines straddling
+// chunk boundaries are stitched and parsed in order once everything is read.
+struct ChunkEdges {
+    std::string head;     // bytes before the first '\n' (the whole chunk if none)
+    std::string tail;     // bytes after the last '\n'
+    bool        has_nl = false;
 };
-struct SvEq {
-    using is_transparent = void;
-    bool operator()(std::string_view a, std::string_view b) const noexcept {
-        return a == b;
+
+static void process_line(std::string_view line, CityMap& results) {
+    const char* le = line.data() + line.size();
+    if (g_query_on) {
+        QueryScratch qs;
+        const char* sep = static_cast<const char*>(std::memchr(line.data(), ';', line.size()));
+        g_query_rows.fetch_add(1, std::memory_order_relaxed);
+        g_query_kept.fetch_add(query_record(line.data(), sep, le, le, results, qs), std::memory_order_relaxed);
+        return;
+    }
+    const char* sep;
+    const uint64_t h = hash_scan<DefaultHash>(line.data(), le, sep);   // finds the ';' while hashing
+    std::string_view city;
+    double v;
+    if (decode_record(line.data(), sep, le, le, city, v)) results.upsert(city, CityMap::stored_hash(h)).update(v);
+}
+
+// Parses the chunks `wait(c, bytes)` hands out, c = 0, 1, ... until it
+// returns false, on n workers, releasing each after its lines are parsed.
+// Returns the parse time summed over the workers, waits excluded.
+template <class Wait, class Release>
+static double parse_chunks(Wait&& wait, Release&& release, ScanBlocksFn scan, unsigned n, CityMap& results) {
+    using EdgeList = std::vector<std::pair<uint64_t, ChunkEdges>>;
+    std::vector<EdgeList> edges(n);
+    std::vector<CityMap> partials;
+    partials.reserve(n);
+    for (unsigned w = 0; w < n; ++w) partials.emplace_back(1 << 12);
+    std::vector<double> busy(n, 0.0);
+
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < n; ++w) {
+        workers.emplace_back([&, w] {
+            std::string_view d;
+            for (uint64_t c = w; wait(c, d); c += n) {
+                const auto a = std::chrono::steady_clock::now();
+                ChunkEdges& e = edges[w].emplace_back(c, ChunkEdges{}).second;
+                const char* first = static_cast<const char*>(std::memchr(d.data(), '\n', d.size()));
+                if (!first) {
+                    e.head.assign(d);
+                } else {
+                    const char* last = static_cast<const char*>(::memrchr(d.data(), '\n', d.size()));
+                    e.head.assign(d.data(), first);
+                    e.tail.assign(last + 1, d.data() + d.size());
+                    e.has_nl = true;
+                    process_chunk(scan, std::string_view(first + 1, static_cast<size_t>(last - first)), partials[w]);
+                }
+                release(c);
+                busy[w] += std::chrono::duration<double>(std::chrono::steady_clock::now() - a).count();
+            }
+        });
     }
+    for (auto& t : workers) t.join();
+
+    results.merge_parallel(partials, n);
+    EdgeList all;
+    for (EdgeList& el : edges) std::move(el.begin(), el.end(), std::back_inserter(all));
+    std::sort(all.begin(), all.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::string carry;
+    for (const auto& [c, e] : all) {
+        carry += e.head;
+        if (!e.has_nl) continue;
+        process_line(carry, results);
+        carry = e.tail;
+    }
+    if (!carry.empty()) process_line(carry, results);   // unterminated last line
+
+    double total = 0.0;
+    for (double b : busy) total += b;
+    return total;
+}
+
+static bool stream_range(const char* path, IoBackend io, bool direct, ScanBlocksFn scan,
+                         unsigned n_threads, uint64_t begin, uint64_t end, CityMap& results) {
+    ChunkPipeline pipe;
+    if (!pipe.start(path, io, begin, end, 2 * n_threads + 2, direct)) return false;
+
+    const uint64_t n_chunks = pipe.chunks();
+    const unsigned n = static_cast<unsigned>(std::min<uint64_t>(n_threads, std::max<uint64_t>(n_chunks, 1)));
+    parse_chunks(
+        [&](uint64_t c, std::string_view& d) {
+            if (c >= n_chunks) return false;
+            d = pipe.wait(c);
+            return !pipe.failed();
+        },
+        [&](uint64_t c) { pipe.release(c); }, scan, n, results);
+    if (!pipe.finish()) return false;
+
+    pipe.stats().report(stderr);
+    return true;
+}
+
+// ---------- Incremental state ----------
+// Where the previous scan stopped. A refresh scans only [offset, last '\n'];
+// a partial last line is left for the next refresh.
+struct ScanState {
+    FileIdentity  id;
+    uint64_t      offset = 0;
+    uint64_t      tail_fp = tail_fingerprint(nullptr, 0);
+};
+
+struct Options {
+    const char* input = "test_sample.txt";
+    const char* output = "test_sample_results_calculated.txt";
+    std::vector<const char*> inputs;   // several files, a directory or a glob: the file-set path
+    std::string checkpoint;         // empty: no checkpoint
+    bool        follow = false;
+    const char* serve = nullptr;    // Unix socket path of the query service
+    const char* query = nullptr;    // with query_request: one client request
+    const char* query_request = nullptr;
+    const char* to_columnar = nullptr;
+    const char* from_columnar = nullptr;
+    bool        scan_columns = false;
+    FormatOptions format;
+    SchedConfig sched;
+    IoBackend   io = IoBackend::Mmap;
+    bool        direct = false;     // O_DIRECT for the pread/uring backends
+    MapOptions  map;                // MAP_POPULATE / madvise for the mmap path
+    bool        huge_tables = false;
+    bool        fault_report = false;
+    bool        hash_report = false;
+    bool        auto_kernel = true;     // probe the input for a specialized scan kernel
+    RecordQuery where;                  // --schema, --filter, --window
+    const char* dict = nullptr;         // station list file, or "sample"
 };
 
-int main() {
-    // ---------- Input ----------
-    FILE* fp = std::fopen("test_sample.txt", "r");
-    if (!fp) { std::perror("fopen"); return 1; }
-
-    // Big input buffer (1 MiB)
-    static char inbuf[1 << 20];
-    std::setvbuf(fp, inbuf, _IOFBF, sizeof inbuf);
-
-    std::unordered_map<std::string, CityResult, SvHash, SvEq> results;
-    results.reserve(1 << 15); // heuristic: adjust if you know #cities
-
-    char*  line = nullptr;  // getline buffer (malloc'ed by libc)
-    size_t cap  = 0;
-    ssize_t len;
-
-    while ((len = getline(&line, &cap, fp)) != -1) {
-        if (len <= 1) continue;
-
-        // Trim trailing newline(s)
-        while (len && (line[len-1] == '\n' || line[len-1] == '\r')) line[--len] = '\0';
-        if (len == 0) continue;
-
-        // Find first ';'
-        char* sep = static_cast<char*>(std::memchr(line, ';', static_cast<size_t>(len)));
-        if (!sep) continue;
-
-        std::string_view city_sv{line, static_cast<size_t>(sep - line)};
-        const char* val_begin = sep + 1;
-        if (val_begin >= line + len) continue;
-
-        // Parse value
-        char* endp = nullptr;
-        double v = std::strtod(val_begin, &endp);
-        if (endp == val_begin) continue; // parse failure
-
-        // Probe without allocation
-        auto it = results.find(city_sv);
-        if (it == results.end()) {
-            // First occurrence: allocate key once
-            std::string key(city_sv);
-            CityResult cr;
-            cr.min = cr.max = v;
-            cr.sum = v;
-            cr.counter = 1;
-            results.emplace(std::move(key), cr);
+static void usage(const char* argv0) {
+    std::fprintf(stderr,
+        "usage: %s [INPUT...] [-o OUTPUT] [--incremental] [--follow | --serve SOCKET] [--checkpoint PATH]\n"
+        "          [--io BACKEND [--direct]]\n"
+        "          [--sched static|morsel] [--sched-report] [--numa] [--decimals N] [--sorted | --canonical]\n"
+        "          [--populate] [--madvise LIST] [--prefetch MIB] [--huge-tables] [--fault-report] [--hash-report]\n"
+        "          [--kernel auto|generic] [--schema FIELDS] [--filter EXPR]... [--window DURATION]\n"
+        "          [--dict FILE|sample]\n"
+        "       %s --to-columnar PATH | --from-columnar PATH [--scan-columns]\n"
+        "       %s --query SOCKET REQUEST\n"
+        "  INPUT...              files, directories or quoted globs (default test_sample.txt); more than\n"
+        "                        one file is scanned by one pool into one result, without --incremental;\n"
+        "                        gzip and zstd inputs are decoded on the fly (one-shot runs only)\n"
+        "  -o, --output PATH     result file (default test_sample_results_calculated.txt)\n"
+        "  --incremental         resume from PATH (default <input>.ckpt) and scan only appended data\n"
+        "  --follow              keep watching the input and refresh results as it grows\n"
+        "  --serve SOCKET        --follow, answering queries on a Unix socket from the live results\n"
+        "  --query SOCKET REQ    send one request (ALL, GET name, PREFIX text, RANGE lo;hi, INFO)\n"
+        "  --checkpoint PATH     checkpoint file (implies --incremental)\n"
+        "  --to-columnar PATH    convert the input to a columnar snapshot and exit\n"
+        "  --from-columnar PATH  answer from a columnar snapshot (block headers only)\n"
+        "  --scan-columns        with --from-columnar, scan the id/value columns instead\n"
+        "  --sched MODE          split the input statically or into morsels (default)\n"
+        "  --sched-report        print per-thread utilization of the scan, the kernel used and the --numa node report\n"
+        "  --numa                one input slice, pinned workers and local tables per NUMA node\n"
+        "  --io BACKEND          mmap (default), stdio, pread or uring; streaming backends report GB/s\n"
+        "  --direct              open the input with O_DIRECT (pread and uring)\n"
+        "  --populate            map the input with MAP_POPULATE (fault it all in up front)\n"
+        "  --madvise LIST        comma list of sequential, hugepage, willneed, or none (default sequential)\n"
+        "  --prefetch MIB        touch input pages this far ahead of the scan from a helper thread\n"
+        "  --huge-tables         allocate station tables of 2 MiB and up from huge pages\n"
+        "  --fault-report        print page faults and system time spent in the scan\n"
+        "  --hash-report         print probe-length and collision histograms of the result table\n"
+        "  --kernel MODE         auto (default) picks a scan kernel specialized to the input's format\n"
+        "  --schema FIELDS       field layout of a line, e.g. city;ts;value (_ skips a field; default city;value)\n"
+        "  --filter EXPR         keep rows with station=A,B,... | value=LO..HI | ts=FROM..TO (bounds optional,\n"
+        "                        ts as epoch seconds or ISO 8601 UTC, TO exclusive); repeat to AND them\n"
+        "  --window DURATION     aggregate per station and time window (e.g. 1h, 15m, 1d); adds a window-start column\n"
+        "  --dict FILE|sample    known stations (one per line, or the names in the probed head of the input):\n"
+        "                        a perfect hash maps them to a dense array; other names use the table\n"
+        "  --decimals N          digits after the point in the results, 0 to 30 (default 8)\n"
+        "  --sorted              write result lines in name order\n"
+        "  --canonical           write the sorted 1BRC form {name=min/mean/max, ...}\n",
+        argv0, argv0, argv0);
+}
+
+static bool parse_args(int argc, char** argv, Options& opt) {
+    bool incremental = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view a = argv[i];
+        if (a == "--incremental") incremental = true;
+        else if (a == "--follow") { opt.follow = true; incremental = true; }
+        else if (a == "--serve" && i + 1 < argc) { opt.serve = argv[++i]; incremental = true; }
+        else if (a == "--query" && i + 2 < argc) { opt.query = argv[++i]; opt.query_request = argv[++i]; }
+        else if (a == "--checkpoint" && i + 1 < argc) { opt.checkpoint = argv[++i]; incremental = true; }
+        else if (a == "--to-columnar" && i + 1 < argc) opt.to_columnar = argv[++i];
+        else if (a == "--from-columnar" && i + 1 < argc) opt.from_columnar = argv[++i];
+        else if (a == "--scan-columns") opt.scan_columns = true;
+        else if (a == "--io" && i + 1 < argc && parse_io_backend(argv[i + 1], opt.io)) ++i;
+        else if (a == "--direct") opt.direct = true;
+        else if (a == "--populate") opt.map.populate = true;
+        else if (a == "--madvise" && i + 1 < argc && parse_madvise(argv[i + 1], opt.map)) ++i;
+        else if (a == "--prefetch" && i + 1 < argc && parse_prefetch(argv[i + 1], opt.sched.prefetch)) ++i;
+        else if (a == "--huge-tables") opt.huge_tables = true;
+        else if (a == "--fault-report") opt.fault_report = true;
+        else if (a == "--hash-report") opt.hash_report = true;
+        else if (a == "--kernel" && i + 1 < argc && std::string_view(argv[i + 1]) == "auto") { opt.auto_kernel = true; ++i; }
+        else if (a == "--kernel" && i + 1 < argc && std::string_view(argv[i + 1]) == "generic") { opt.auto_kernel = false; ++i; }
+        else if (a == "--sched" && i + 1 < argc && std::string_view(argv[i + 1]) == "static") { opt.sched.mode = Sched::Static; ++i; }
+        else if (a == "--sched" && i + 1 < argc && std::string_view(argv[i + 1]) == "morsel") { opt.sched.mode = Sched::Morsel; ++i; }
+        else if (a == "--schema" && i + 1 < argc) { if (!parse_schema(argv[++i], opt.where.schema)) return false; }
+        else if (a == "--filter" && i + 1 < argc) { if (!opt.where.add_filter(argv[++i])) return false; }
+        else if (a == "--window" && i + 1 < argc) { if (!opt.where.set_window(argv[++i])) return false; }
+        else if (a == "--dict" && i + 1 < argc) opt.dict = argv[++i];
+        else if (a == "--sched-report") opt.sched.report = true;
+        else if (a == "--numa") opt.sched.numa = true;
+        else if (a == "--decimals" && i + 1 < argc && parse_decimals(argv[i + 1], opt.format.decimals)) ++i;
+        else if (a == "--sorted") opt.format.sorted = true;
+        else if (a == "--canonical") opt.format.canonical = true;
+        else if ((a == "--output" || a == "-o") && i + 1 < argc) opt.output = argv[++i];
+        else if (!a.empty() && a[0] != '-') opt.inputs.push_back(argv[i]);
+        else { usage(argv[0]); return false; }
+    }
+    // A single regular file keeps the single-input path and all its modes
+    struct stat st;
+    if (opt.inputs.size() == 1 && ::stat(opt.inputs[0], &st) == 0 && S_ISREG(st.st_mode)) {
+        opt.input = opt.inputs[0];
+        opt.inputs.clear();
+    }
+    if (!opt.inputs.empty() && (incremental || opt.to_columnar || opt.io != IoBackend::Mmap)) {
+        std::fprintf(stderr, "--incremental, --follow, --serve, --checkpoint, --to-columnar and --io need a single input file\n");
+        return false;
+    }
+    if (opt.where.active() && (incremental || opt.to_columnar || opt.from_columnar)) {
+        std::fprintf(stderr, "--schema, --filter and --window are for one-shot scans (no checkpoints or columnar files)\n");
+        return false;
+    }
+    if (!opt.where.check()) return false;
+    if (incremental && opt.checkpoint.empty()) opt.checkpoint = std::string(opt.input) + ".ckpt";
+    return true;
+}
+
+// The --sched-report kernel line, --fault-report and --hash-report.
+static void report_scan(const Options& opt, const KernelProbe& probe, const FaultSnapshot& f0, const CityMap& results) {
+    if (opt.sched.report && g_query_on) {
+        const uint64_t rows = g_query_rows.load(), kept = g_query_kept.load();
+        std::fprintf(stderr, "kernel: filtered (kept %llu of %llu rows, %.1f%%)\n", static_cast<unsigned long long>(kept),
+                     static_cast<unsigned long long>(rows), rows ? 100.0 * static_cast<double>(kept) / static_cast<double>(rows) : 0.0);
+    } else if (opt.sched.report) {
+        std::fprintf(stderr, "kernel: %s", g_kernel.name);
+        if (probe.bytes) {
+            std::fprintf(stderr, " (probed %.1f MB: %llu records, ", static_cast<double>(probe.bytes) / 1e6,
+                         static_cast<unsigned long long>(probe.records));
+            if (probe.decimals) std::fprintf(stderr, "%d-decimal values, ", probe.decimals);
+            std::fprintf(stderr, "names <= %zu bytes, %.1f rows per station run)", probe.max_key, probe.mean_run());
+        }
+        if (!g_dict.empty()) {
+            std::fprintf(stderr, ", dictionary of %u names (%s key hash, %.1f KiB), %llu rows outside it", g_dict.size(),
+                         g_dict.narrow() ? "8-byte" : "full", static_cast<double>(g_dict.bytes()) / 1024,
+                         static_cast<unsigned long long>(g_dict_misses.load()));
+        }
+        if (const uint64_t fb = g_kernel_fallbacks.load()) {
+            std::fprintf(stderr, ", %llu records broke the format: %s from there on",
+                         static_cast<unsigned long long>(fb), g_kernel.broken ? g_kernel.broken->name : kGenericKernel.name);
+        }
+        std::fprintf(stderr, "\n");
+    }
+    if (opt.fault_report) {
+        report_faults(stderr, f0, FaultSnapshot::now());
+        const auto [hugetlb, thp] = HugePageArena::instance().totals();
+        if (opt.huge_tables) {
+            std::fprintf(stderr, "  huge-page tables: %.1f MiB hugetlbfs, %.1f MiB transparent\n",
+                         static_cast<double>(hugetlb) / (1 << 20), static_cast<double>(thp) / (1 << 20));
+        }
+    }
+    if (opt.hash_report) results.probe_stats().report(stderr, hash_name<DefaultHash>());
+}
+
+// Brings `results` up to date with the input. Returns false on I/O errors.
+static bool refresh(const Options& opt, ScanBlocksFn scan, unsigned n_threads,
+                    ScanState& st, CityMap& results) {
+    auto t0 = std::chrono::steady_clock::now();
+    const FaultSnapshot f0 = FaultSnapshot::now();
+
+    FileIdentity id;
+    if (!stat_identity(opt.input, id)) { std::perror("stat"); return false; }
+
+    // A different file, or one that shrank, invalidates everything we have
+    bool reset = id.dev != st.id.dev || id.ino != st.id.ino || id.size < st.offset;
+
+    MappedFile in;
+    const uint64_t lead = reset || st.offset < 64 ? 0 : st.offset - 64;
+    if (!in.open(opt.input, lead, opt.map)) return false;
+    id.size = in.file_size;
+
+    // Same inode but rewritten in place: the bytes before offset changed
+    if (!reset && tail_fingerprint(in.at(st.offset), st.offset) != st.tail_fp) reset = true;
+    if (reset) {
+        if (st.offset) std::fprintf(stderr, "input changed, rescanning from the start\n");
+        results = CityMap(1 << 12);
+        st = ScanState{};
+        if (lead != 0 && !in.open(opt.input, 0, opt.map)) return false;
+    }
+
+    // Incremental runs stop after the last complete line; a one-shot run takes it all
+    uint64_t end = in.file_size;
+    if (!opt.checkpoint.empty()) {
+        while (end > st.offset && *in.at(end - 1) != '\n') --end;
+    }
+
+    const uint64_t added = end - st.offset;
+    KernelProbe probe;
+    g_kernel = opt.auto_kernel && added ? probe_kernel(scan, in.at(st.offset), static_cast<size_t>(added), probe)
+                                        : kGenericKernel;
+    g_kernel_broken = false;
+    g_kernel_fallbacks = 0;
+    if (added && opt.io != IoBackend::Mmap) {
+        // The mapping above only served the fingerprint, line-end and kernel probe
+        if (!stream_range(opt.input, opt.io, opt.direct, scan, n_threads, st.offset, end, results)) return false;
+    } else if (added) {
+        aggregate_range(scan, in.at(st.offset), static_cast<size_t>(added), n_threads, opt.sched, results);
+    }
+    if (added) report_scan(opt, probe, f0, results);
+
+    st.tail_fp = tail_fingerprint(in.at(end), end);
+    st.offset = end;
+    st.id = id;
+
+    if (!write_results_file(results, opt.output, opt.format)) return false;
+    if (!opt.checkpoint.empty() &&
+        !save_checkpoint(opt.checkpoint.c_str(), st.id, st.offset, st.tail_fp, results)) return false;
+
+    if (!opt.checkpoint.empty()) {
+        auto t1 = std::chrono::steady_clock::now();
+        std::fprintf(stderr, "scanned +%llu bytes in %.2f ms, %zu stations\n",
+                     static_cast<unsigned long long>(added),
+                     std::chrono::duration<double, std::milli>(t1 - t0).count(), results.size());
+    }
+    return true;
+}
+
+// ---------- Follow mode ----------
+static std::atomic<bool> g_stop{false};   // lock-free, so safe to set from a signal handler
+
+static void install_stop_handlers() {
+    std::signal(SIGINT, [](int) { g_stop = true; });
+    std::signal(SIGTERM, [](int) { g_stop = true; });
+}
+
+// on_refresh runs after every successful refresh.
+static int follow(const Options& opt, ScanBlocksFn scan, unsigned n_threads,
+                  ScanState& st, CityMap& results, const std::function<void()>& on_refresh = {}) {
+
+    int fd = -1;
+#ifdef __linux__
+    fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd >= 0 && ::inotify_add_watch(fd, opt.input, IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB) < 0) {
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+    // Without inotify, fall back to polling the file once a second
+    while (!g_stop) {
+        if (fd >= 0) {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 1000) > 0) {
+                char evbuf[4096];
+                while (::read(fd, evbuf, sizeof evbuf) > 0) {}  // drain; we re-stat anyway
+            }
         } else {
-            CityResult& cr = it->second;
-            if (v < cr.min) cr.min = v;
-            if (v > cr.max) cr.max = v;
-            cr.sum += v;
-            cr.counter += 1;
+            ::usleep(1000 * 1000);
+        }
+        FileIdentity id;
+        if (g_stop || !stat_identity(opt.input, id)) continue;
+        if (id.ino == st.id.ino && id.size == st.id.size && id.mtime_ns == st.id.mtime_ns) continue;
+        if (!refresh(opt, scan, n_threads, st, results)) {
+            if (fd >= 0) ::close(fd);
+            return 1;
         }
+        if (on_refresh) on_refresh();
     }
-    std::free(line);
-    std::fclose(fp);
+    if (fd >= 0) ::close(fd);
+    return 0;
+}
 
-    // ---------- Output ----------
-    FILE* out = std::fopen("test_sample_results_calculated.txt", "w");
-    if (!out) { std::perror("fopen"); return 1; }
+// ---------- Query service ----------
+// Follow mode with the results kept queryable: the ingest thread refreshes the
+// table as the input grows and publishes a sorted, pre-formatted snapshot after
+// each refresh; the main thread answers socket queries from whichever snapshot
+// is current, so queries never wait on a scan and never see a half-merged table.
+static int serve(const Options& opt, ScanBlocksFn scan, unsigned n_threads, ScanState& st, CityMap& results) {
+    QueryServer server;
+    if (!server.listen(opt.serve)) return 1;
+    uint64_t generation = 0;
+    auto publish = [&] {
+        server.publish(std::make_shared<const StationSnapshot>(results, opt.format, st.offset, generation++));
+    };
+    publish();
+    std::fprintf(stderr, "serving %zu stations on %s\n", results.size(), opt.serve);
 
-    static char outbuf[1 << 20];
-    std::setvbuf(out, outbuf, _IOFBF, sizeof outbuf);
+    int rc = 0;
+    std::thread ingest([&] {
+        rc = follow(opt, scan, n_threads, st, results, publish);
+        g_stop = true;   // a failed refresh stops the service too
+    });
+    server.run(g_stop);
+    ingest.join();
+    return rc;
+}
 
-    char numbuf[64];
+// ---------- Multi-file input ----------
+// Every file goes through one pool of n_threads workers (FileSetReader): each
+// worker parses whichever piece is next, from any file, into its own table,
+// and the tables merge once at the end as in aggregate_range. Small files are
+// read whole by the worker that claims them, so a thousand shards cost a
+// thousand read()s, not a thousand thread starts or mappings. The scan
+// kernel is probed on the head of the largest file (decoded, if compressed).
+static int aggregate_files(const Options& opt, ScanBlocksFn scan, unsigned n_threads) {
+    const FaultSnapshot f0 = FaultSnapshot::now();
+    std::vector<InputFile> files;
+    if (!expand_inputs(std::vector<std::string>(opt.inputs.begin(), opt.inputs.end()), files)) return 1;
+    // Never read our own output back, e.g. from a directory input that holds it
+    FileIdentity out_id;
+    if (stat_identity(opt.output, out_id)) {
+        std::erase_if(files, [&](const InputFile& f) { return f.dev == out_id.dev && f.ino == out_id.ino; });
+    }
+    uint64_t total = 0;
+    for (const InputFile& f : files) total += f.size;
+
+    KernelProbe probe;
+    g_kernel = kGenericKernel;
+    if (opt.auto_kernel && !files.empty()) {
+        const InputFile& big = *std::max_element(files.begin(), files.end(),
+                                                 [](const InputFile& a, const InputFile& b) { return a.size < b.size; });
+        std::vector<char> head;
+        size_t len = 0;
+        bool whole = false;
+        if (big.codec != Codec::None) {
+            decode_head(big.codec, big.path.c_str(), kProbeBytes, head);
+            len = head.size();
+        } else {
+            head.resize(static_cast<size_t>(std::min<uint64_t>(big.size, kProbeBytes)));
+            const int fd = ::open(big.path.c_str(), O_RDONLY | O_CLOEXEC);
+            const ssize_t got = fd < 0 ? -1 : ::pread(fd, head.data(), head.size(), 0);
+            if (fd >= 0) ::close(fd);
+            len = got > 0 ? static_cast<size_t>(got) : 0;
+            whole = len == big.size;
+        }
+        if (!whole) {   // only whole lines: a cut value would read as another format
+            const void* nl = ::memrchr(head.data(), '\n', len);
+            len = nl ? static_cast<size_t>(static_cast<const char*>(nl) - head.data()) + 1 : 0;
+        }
+        if (len) g_kernel = probe_kernel(scan, head.data(), len, probe);
+    }
+
+    const unsigned n = static_cast<unsigned>(std::clamp<uint64_t>(total >> 20, 1, std::max(n_threads, 1u)));
+    FileSetReader reader(std::move(files), morsel_size(static_cast<size_t>(total), n), opt.map);
+    std::vector<CityMap> partials;
+    partials.reserve(n);
+    for (unsigned i = 0; i < n; ++i) partials.emplace_back(1 << 12);
+    std::vector<WorkerStats> stats(n);
 
-    for (const auto& kv : results) {
-        const std::string& city = kv.first;
-        const CityResult& cr = kv.second;
-        const double mean = cr.counter ? cr.sum / static_cast<double>(cr.counter) : 0.0;
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    auto ms_since = [](clock::time_point a, clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(n);
+    for (unsigned i = 0; i < n; ++i) {
+        workers.emplace_back([&, i] {
+            WorkerStats& ws = stats[i];
+            FileSetReader::Buffer buf;
+            FileSetReader::Piece piece;
+            while (reader.next(buf, piece)) {
+                const auto a = clock::now();
+                process_chunk(scan, piece.bytes, partials[i]);
+                reader.release(piece);
+                ws.busy_ms += ms_since(a, clock::now());
+                ++ws.morsels;
+                ws.bytes += piece.bytes.size();
+            }
+            ws.done_ms = ms_since(t0, clock::now());
+        });
+    }
+    for (auto& t : workers) t.join();
+    if (reader.failed()) return 1;
+    const auto t1 = clock::now();
+
+    CityMap results(1 << 12);
+    results.merge_parallel(partials, n);
 
-        // city;
-        std::fwrite(city.data(), 1, city.size(), out);
-        std::fputc(';', out);
+    if (opt.sched.report) {
+        char label[96];
+        std::snprintf(label, sizeof label, "%zu files (%zu read, %zu mapped, %zu decoded), morsel %.1f MiB",
+                      reader.files().size(), reader.read_files(), reader.mapped_files(), reader.decoded_files(),
+                      static_cast<double>(reader.morsel()) / (1 << 20));
+        report_utilization(stderr, label, stats, ms_since(t0, t1));
+        std::fprintf(stderr, "  merge: %u tables into %zu stations in %.1f ms\n", n, results.size(), ms_since(t1, clock::now()));
+    }
+    report_scan(opt, probe, f0, results);
+    return write_results_file(results, opt.output, opt.format) ? 0 : 1;
+}
 
-        // mean;min;max with fixed 8 decimals
-        int n = std::snprintf(numbuf, sizeof numbuf, "%.8f", mean);
-        std::fwrite(numbuf, 1, static_cast<size_t>(n), out);
-        std::fputc(';', out);
+// ---------- Compressed input ----------
+// A gzip or zstd file is decoded in memory by a DecodePipeline and its
+// decoded units are parsed as they land, with the chunk-edge stitching of
+// stream_range, so decode and parse overlap and nothing is written out.
+// Independent frames decode on up to n_threads decoder threads; the parsers
+// block while waiting, so the two pools share the cores. The scan kernel is
+// probed on the first decoded unit.
+static int aggregate_compressed(const Options& opt, ScanBlocksFn scan, unsigned n_threads, Codec codec) {
+    const FaultSnapshot f0 = FaultSnapshot::now();
+    MappedFile in;
+    if (!in.open(opt.input, 0, opt.map)) return 1;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    DecodePipeline pipe;
+    if (!pipe.start(in.at(0), static_cast<size_t>(in.file_size), codec, 2 * n_threads + 2, n_threads)) return 1;
+
+    KernelProbe probe;
+    g_kernel = kGenericKernel;
+    std::string_view first;
+    if (opt.auto_kernel && pipe.wait(0, first)) {
+        const void* nl = ::memrchr(first.data(), '\n', std::min(first.size(), kProbeBytes));
+        if (nl) g_kernel = probe_kernel(scan, first.data(), static_cast<size_t>(static_cast<const char*>(nl) - first.data()) + 1, probe);
+    }
+    g_kernel_broken = false;
+    g_kernel_fallbacks = 0;
 
-        n = std::snprintf(numbuf, sizeof numbuf, "%.8f", cr.min);
-        std::fwrite(numbuf, 1, static_cast<size_t>(n), out);
-        std::fputc(';', out);
+    CityMap results(1 << 12);
+    const double parse_busy = parse_chunks([&](uint64_t c, std::string_view& d) { return pipe.wait(c, d); },
+                                           [&](uint64_t c) { pipe.release(c); }, scan, n_threads, results);
+    if (!pipe.finish()) return 1;
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
 
-        n = std::snprintf(numbuf, sizeof numbuf, "%.8f", cr.max);
-        std::fwrite(numbuf, 1, static_cast<size_t>(n), out);
-        std::fputc('\n', out);
+    const DecodeStats& ds = pipe.stats();
+    ds.report(stderr);
+    const double gb = static_cast<double>(ds.out_bytes) / 1e9;
+    std::fprintf(stderr, "parse: %.2f GB on %u threads, %.2f GB/s per parser thread, %.2f GB/s end to end (%.3f s)\n",
+                 gb, n_threads, parse_busy > 0 ? gb / parse_busy : 0.0, wall > 0 ? gb / wall : 0.0, wall);
+    report_scan(opt, probe, f0, results);
+    return write_results_file(results, opt.output, opt.format) ? 0 : 1;
+}
+
+// ---------- Columnar snapshot ----------
+// Two passes over the text: the normal parallel aggregation finds the station
+// set and row count (so ids and column offsets are fixed up front), then a
+// sequential pass streams ids and values into the snapshot.
+static int convert_to_columnar(const Options& opt, ScanBlocksFn scan, unsigned n_threads) {
+    MappedFile in;
+    if (!in.open(opt.input, 0, opt.map)) return 1;
+    const char* data = in.at(0);
+    const size_t size = static_cast<size_t>(in.file_size);
+
+    CityMap stats(1 << 12);
+    aggregate_range(scan, data, size, n_threads, opt.sched, stats);
+
+    std::vector<std::string_view> names;
+    uint64_t rows = 0;
+    stats.for_each([&](std::string_view city, const CityResult<>& cr) {
+        names.push_back(city);
+        rows += static_cast<uint64_t>(cr.count());
+    });
+    std::sort(names.begin(), names.end());
+
+    std::unordered_map<std::string_view, uint32_t, SvHash, SvEq> ids;
+    ids.reserve(names.size());
+    for (uint32_t i = 0; i < names.size(); ++i) ids.emplace(names[i], i);
+
+    ColumnarWriter<> w;
+    if (!w.open(opt.to_columnar, names, rows)) return 1;
+    for_each_record(scan, data, size, [&](const char* line, const char* sep, const char* le) {
+        std::string_view city;
+        double v;
+        if (decode_record(line, sep, le, data + size, city, v)) w.add(ids.find(city)->second, v);
+    });
+    if (!w.close()) return 1;
+
+    std::fprintf(stderr, "wrote %llu rows, %zu stations (%u-byte ids) to %s\n",
+                 static_cast<unsigned long long>(rows), names.size(), id_width_for(names.size()),
+                 opt.to_columnar);
+    return 0;
+}
+
+static int query_columnar(const Options& opt, unsigned n_threads) {
+    ColumnarFile<> col;
+    if (!col.open(opt.from_columnar)) return 1;
+    const ColumnarHeader& h = col.header();
+
+    std::vector<CityResult<>> dense;
+    if (!opt.scan_columns) {
+        dense = col.aggregate_from_blocks();
+    } else {
+        // Block-aligned row ranges, one dense table per thread, merged in order
+        const uint64_t blocks_per = (h.blocks + n_threads - 1) / n_threads;
+        std::vector<std::vector<CityResult<>>> partials;
+        partials.reserve(n_threads);  // workers hold references into it
+        std::vector<std::thread> workers;
+        for (uint64_t b = 0; b < h.blocks; b += blocks_per) {
+            const uint64_t begin = b * h.block_rows;
+            const uint64_t end = std::min<uint64_t>(h.rows, (b + blocks_per) * h.block_rows);
+            partials.emplace_back(h.stations);
+            workers.emplace_back([&col, &part = partials.back(), begin, end] {
+                col.scan_rows(begin, end, part);
+            });
+        }
+        for (auto& t : workers) t.join();
+        dense.assign(h.stations, CityResult<>{});
+        for (const auto& part : partials) {
+            for (uint32_t i = 0; i < h.stations; ++i) dense[i].merge(part[i]);
+        }
+    }
+
+    CityMap results(h.stations * 2);
+    // Block headers and columns carry no samples for extended statistics;
+    // those columns come out as nan under BRC_STATS
+    for (uint32_t i = 0; i < h.stations; ++i) static_cast<CityResult<>&>(results.upsert(col.name(i))) = dense[i];
+    return write_results_file(results, opt.output, opt.format) ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) return 2;
+
+    ScanBlocksFn scan = select_scanner();
+    g_query = opt.where;
+    g_query_on = g_query.active();
+    if (opt.dict && std::string_view(opt.dict) == "sample") {
+        g_dict_sample = true;
+    } else if (opt.dict) {
+        std::vector<std::string> list;
+        if (!load_station_list(opt.dict, list)) return 1;
+        if (!set_dictionary(std::vector<std::string_view>(list.begin(), list.end()))) {
+            std::fprintf(stderr, "%s: no usable station names\n", opt.dict);
+            return 1;
+        }
+    }
+    HugePageArena::instance().enable(opt.huge_tables);
+
+    unsigned n_threads = std::thread::hardware_concurrency();
+    if (n_threads == 0) n_threads = 1;
+
+    if (opt.query) return query_server(opt.query, opt.query_request, stdout) ? 0 : 1;
+    if (opt.inputs.empty() && !opt.from_columnar) {
+        if (const Codec codec = sniff_codec(opt.input); codec != Codec::None) {
+            if (!opt.checkpoint.empty() || opt.to_columnar) {
+                std::fprintf(stderr, "%s: %s input is one-shot only (no --incremental, --follow, --serve, "
+                             "--checkpoint or --to-columnar)\n", opt.input, codec_name(codec));
+                return 2;
+            }
+            return aggregate_compressed(opt, scan, n_threads, codec);
+        }
+    }
+    if (opt.to_columnar) return convert_to_columnar(opt, scan, n_threads);
+    if (opt.from_columnar) return query_columnar(opt, n_threads);
+    if (!opt.inputs.empty()) return aggregate_files(opt, scan, n_threads);
+
+    CityMap results(1 << 12);
+    ScanState st;
+
+    // ---------- Resume ----------
+    if (!opt.checkpoint.empty()) {
+        CheckpointHeader h;
+        if (load_checkpoint(opt.checkpoint.c_str(), h, results)) {
+            st.id = h.id;
+            st.offset = h.offset;
+            st.tail_fp = h.tail_fp;
+        } else {
+            results = CityMap(1 << 12);
+        }
     }
 
-    std::fclose(out);
+    if (opt.follow || opt.serve) install_stop_handlers();
+    if (!refresh(opt, scan, n_threads, st, results)) return 1;
+    if (opt.serve) return serve(opt, scan, n_threads, st, results);
+    if (opt.follow) return follow(opt, scan, n_threads, st, results);
     return 0;
 }
@@ -0,0 +1,411 @@
+// station_table.hpp
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "city_result.hpp"
+#include "hash_suite.hpp"
+#include "huge_pages.hpp"
+#include "key_arena.hpp"
+
+// ---------- Flat station table ----------
+// Open addressing with linear probing over a power-of-two array of 64-byte
+// slots. Each slot holds the full 64-bit hash, where the key lives in the
+// table's KeyArena, the first kPrefix key bytes and the CityResult
+// accumulators, so a hit on a short name touches exactly one cache line. The
+// full hash is compared first; key bytes are only compared when the hashes
+// match. The prefix shrinks to whatever the result type leaves free (16
+// bytes for 32-byte results, 8 for 40) and is gone for 48-byte ones, whose
+// keys are always compared in the arena.
+//
+// The home slot comes from the top bits of a multiplicative mix of the hash,
+// so the top s bits of the home index are the same for every capacity: shard
+// k of 2^s always lives in the k-th 1/2^s of any table, which is what lets
+// merge_parallel split the work by slot range.
+template <class Result, std::size_t Prefix = 64 - 16 - sizeof(Result)>
+struct alignas(64) StationSlot {
+    static constexpr std::size_t kPrefix = Prefix;
+    static constexpr std::size_t kMaxLen = (std::size_t{1} << 24) - 1;
+
+    std::uint64_t hash = 0;          // 0 marks an empty slot
+    std::uint64_t off : 40 = 0;      // full name in the table's KeyArena
+    std::uint64_t len : 24 = 0;
+    char          prefix[kPrefix] = {};
+    Result        value;
+};
+
+template <class Result>
+struct alignas(64) StationSlot<Result, 0> {
+    static constexpr std::size_t kPrefix = 0;
+    static constexpr std::size_t kMaxLen = (std::size_t{1} << 24) - 1;
+
+    std::uint64_t hash = 0;
+    std::uint64_t off : 40 = 0;
+    std::uint64_t len : 24 = 0;
+    Result        value;
+};
+
+// The shipped policies leave the 16-byte prefix that upsert_short and the
+// key16 scan kernels compare against (-DBRC_ACCUM=NeumaierSum gives it up).
+static_assert(StationSlot<CityResult<MixedSum<2>>>::kPrefix >= 16 && StationSlot<CityResult<FixedSum<6>>>::kPrefix >= 16 &&
+                  StationSlot<CityResult<PlainSum>>::kPrefix >= 16,
+              "CityResult must stay at 32 bytes");
+
+// ---------- Probe statistics ----------
+// probe_hist[d]: keys stored d slots past their home slot (the expected
+// lookup cost); home_hist[n]: home slots that n keys hash to (the collision
+// profile before probing); hash_collisions: keys whose full 64-bit hash equals
+// another key's, which the slot compare cannot skip. Last buckets are "or more".
+struct ProbeStats {
+    static constexpr std::size_t kBuckets = 16;
+
+    std::size_t keys = 0;
+    std::size_t capacity = 0;
+    std::size_t probe_hist[kBuckets] = {};
+    std::size_t home_hist[kBuckets] = {};
+    std::size_t total_probe = 0;
+    std::size_t max_probe = 0;
+    std::size_t hash_collisions = 0;
+
+    double mean_probe() const { return keys ? static_cast<double>(total_probe) / static_cast<double>(keys) : 0.0; }
+
+    void report(FILE* fp, const char* label) const {
+        std::fprintf(fp, "hash %s: %zu keys in %zu slots, probe mean %.3f max %zu, full-hash collisions %zu\n", label,
+                     keys, capacity, mean_probe(), max_probe, hash_collisions);
+        auto row = [&](const char* name, const std::size_t* h, std::size_t first) {
+            std::fprintf(fp, "  %-12s", name);
+            for (std::size_t b = first; b < kBuckets; ++b) {
+                if (h[b]) std::fprintf(fp, " %zu%s:%zu", b, b + 1 == kBuckets ? "+" : "", h[b]);
+            }
+            std::fprintf(fp, "\n");
+        };
+        row("probe len", probe_hist, 0);
+        row("keys/home", home_hist, 1);
+    }
+};
+
+template <class Hash = SvHash, class Result = CityResult<>>
+class StationTable {
+public:
+    using Slot = StationSlot<Result>;
+    using SlotVector = std::vector<Slot, HugePageAllocator<Slot>>;   // 2 MiB pages once enabled
+    using result_type = Result;
+    static_assert(sizeof(Slot) == 64, "StationSlot must fill one cache line");
+
+    explicit StationTable(std::size_t capacity = 1 << 15) {
+        std::size_t cap = 16;
+        while (cap < capacity) cap <<= 1;
+        slots_.resize(cap);
+        set_capacity(cap);
+    }
+
+    StationTable(const StationTable&) = delete;
+    StationTable& operator=(const StationTable&) = delete;
+    StationTable(StationTable&& o) noexcept
+        : slots_(std::move(o.slots_)), keys_(std::move(o.keys_)), mask_(o.mask_), shift_(o.shift_), size_(o.size_) {
+        o.slots_.clear();
+        o.size_ = 0;
+    }
+    StationTable& operator=(StationTable&& o) noexcept {
+        if (this != &o) {
+            slots_ = std::move(o.slots_);
+            keys_ = std::move(o.keys_);
+            mask_ = o.mask_;
+            shift_ = o.shift_;
+            size_ = o.size_;
+            o.slots_.clear();
+            o.size_ = 0;
+        }
+        return *this;
+    }
+
+    static std::uint64_t hash_of(std::string_view key) noexcept {
+        return stored_hash(static_cast<std::uint64_t>(Hash{}(key)));
+    }
+    // Same value for a key still in the input buffer, readable up to limit.
+    static std::uint64_t hash_of(std::string_view key, const char* limit) noexcept {
+        return stored_hash(hash_bounded<Hash>(key.data(), key.size(), limit));
+    }
+    static std::uint64_t stored_hash(std::uint64_t h) noexcept {
+        return h ? h : 1;  // keep 0 free as the empty marker
+    }
+
+    // Heterogeneous lookup: no std::string is built to probe.
+    Result* find(std::string_view key) noexcept {
+        return find(key, hash_of(key));
+    }
+    Result* find(std::string_view key, std::uint64_t h) noexcept {
+        for (std::size_t i = index_of(h);; i = (i + 1) & mask_) {
+            Slot& s = slots_[i];
+            if (s.hash == 0) return nullptr;
+            if (s.hash == h && equal(s, key)) return &s.value;
+        }
+    }
+
+    // Returns the slot for key, inserting an empty Result if absent.
+    Result& upsert(std::string_view key) {
+        return upsert(key, hash_of(key));
+    }
+    Result& upsert(std::string_view key, std::uint64_t h) {
+        std::size_t i = index_of(h);
+        for (;; i = (i + 1) & mask_) {
+            Slot& s = slots_[i];
+            if (s.hash == 0) break;
+            if (s.hash == h && equal(s, key)) return s.value;
+        }
+        if ((size_ + 1) * 2 > slots_.size()) {
+            grow();
+            return upsert(key, h);
+        }
+        if (key.size() > Slot::kMaxLen) {
+            std::fprintf(stderr, "station name of %zu bytes is too long\n", key.size());
+            std::abort();
+        }
+        Slot& s = slots_[i];
+        s.hash = h;
+        s.off  = keys_.add(key);
+        s.len  = key.size();
+        if constexpr (Slot::kPrefix > 0) {
+            std::memcpy(s.prefix, key.data(), key.size() < Slot::kPrefix ? key.size() : Slot::kPrefix);
+        }
+        ++size_;
+        return s.value;
+    }
+
+    // upsert for a key of at most 16 bytes passed as its two zero-padded
+    // words: a hit compares them against the slot prefix (zero past the key)
+    // instead of calling memcmp. The first sighting goes through upsert.
+    Result& upsert_short(std::string_view key, std::uint64_t h, std::uint64_t w0, std::uint64_t w1)
+        requires (Slot::kPrefix >= 16)
+    {
+        for (std::size_t i = index_of(h);; i = (i + 1) & mask_) {
+            Slot& s = slots_[i];
+            if (s.hash == 0) break;
+            if (s.hash == h && s.len == key.size()) {
+                std::uint64_t p0, p1;
+                std::memcpy(&p0, s.prefix, 8);
+                std::memcpy(&p1, s.prefix + 8, 8);
+                if (p0 == w0 && p1 == w1) return s.value;
+            }
+        }
+        return upsert(key, h);
+    }
+
+    // Room for n keys in total without growing.
+    void reserve(std::size_t n) {
+        std::size_t cap = slots_.size();
+        while ((n + 1) * 2 > cap) cap <<= 1;
+        if (cap != slots_.size()) rehash(cap);
+    }
+
+    // Fold another table in, reusing its stored hashes. Another table's slots
+    // come out in home-index order, so they are only spread evenly if no
+    // growth happens halfway; hence the reserve for the worst case (no
+    // shared keys).
+    void merge(const StationTable& o) {
+        reserve(size_ + o.size_);
+        for (const Slot& s : o.slots_) {
+            if (s.hash) upsert(o.name_of(s), s.hash).merge(s.value);
+        }
+    }
+
+    // Folds `parts` in after the current contents, sharded by hash on up to
+    // n_threads threads. Per key, contributions combine in the same order as
+    // merging the parts one by one, so the result is bit-identical to that.
+    //   1. shard k gathers its keys from slot range k of every table (plus
+    //      the probe run spilling past the range end) into a private table.
+    //      Its keys share the top bits of index_of, so the private table is
+    //      keyed by the hash rotated by the shard bits; otherwise they would
+    //      all home into one slice of it and probe as one long run;
+    //   2. each shard moves its slots into its own slot range of the new,
+    //      exactly sized table; the few that would probe past the range end
+    //      are placed serially afterwards.
+    void merge_parallel(std::vector<StationTable>& parts, unsigned n_threads) {
+        std::size_t min_cap = slots_.size(), max_size = size_;
+        for (const StationTable& t : parts) {
+            min_cap = std::min(min_cap, t.slots_.size());
+            max_size = std::max(max_size, t.size_);
+        }
+        unsigned bits = 0;
+        while ((2u << bits) <= n_threads && (std::size_t{2} << bits) <= min_cap / 64) ++bits;
+        const unsigned n_shards = 1u << bits;
+        if (n_shards == 1) {
+            for (const StationTable& t : parts) merge(t);
+            return;
+        }
+
+        // 1. Gather
+        std::vector<StationTable> shards;
+        shards.reserve(n_shards);
+        for (unsigned k = 0; k < n_shards; ++k) shards.emplace_back(16);
+        run_shards(n_shards, [&](unsigned k) {
+            StationTable& dst = shards[k];
+            dst = StationTable(2 * max_size / n_shards + 16);
+            scan_shard(*this, k, bits, [&](const Slot& s) {
+                dst.upsert(name_of(s), std::rotl(s.hash, static_cast<int>(bits))).merge(s.value);
+            });
+            for (const StationTable& t : parts) {
+                scan_shard(t, k, bits, [&](const Slot& s) {
+                    dst.upsert(t.name_of(s), std::rotl(s.hash, static_cast<int>(bits))).merge(s.value);
+                });
+            }
+        });
+
+        // 2. Scatter into the new table. The shard arenas are concatenated
+        //    into its arena up front, so a moved slot only rebases its offset.
+        std::size_t total = 0, key_bytes = 0;
+        for (const StationTable& sh : shards) {
+            total += sh.size_;
+            key_bytes += sh.keys_.size();
+        }
+        std::size_t cap = 16;
+        while (cap < 2 * total + 2 || cap < slots_.size()) cap <<= 1;
+        StationTable out(cap);
+        out.keys_.reserve(key_bytes);
+        std::vector<std::uint64_t> base(n_shards);
+        for (unsigned k = 0; k < n_shards; ++k) base[k] = out.keys_.append(shards[k].keys_);
+        std::vector<std::vector<Slot>> spill(n_shards);
+        run_shards(n_shards, [&](unsigned k) {
+            const std::size_t lo = cap / n_shards * k, hi = lo + cap / n_shards;
+            for (Slot& s : shards[k].slots_) {
+                if (!s.hash) continue;
+                s.hash = std::rotr(s.hash, static_cast<int>(bits));
+                s.off = s.off + base[k];
+                std::size_t i = out.index_of(s.hash);
+                while (i < hi && out.slots_[i].hash) ++i;
+                if (i < hi) out.slots_[i] = std::move(s);
+                else        spill[k].push_back(std::move(s));
+            }
+        });
+        for (auto& list : spill) {
+            for (Slot& s : list) {
+                std::size_t i = out.index_of(s.hash);
+                while (out.slots_[i].hash) i = (i + 1) & out.mask_;
+                out.slots_[i] = std::move(s);
+            }
+        }
+        out.size_ = total;
+        *this = std::move(out);
+    }
+
+    template <class F>
+    void for_each(F&& f) const {
+        for (const Slot& s : slots_) {
+            if (s.hash) f(name_of(s), s.value);
+        }
+    }
+
+    std::size_t size() const noexcept { return size_; }
+    std::size_t capacity() const noexcept { return slots_.size(); }
+    std::size_t key_bytes() const noexcept { return keys_.size(); }
+
+    // How well the hash spreads this table's keys; see ProbeStats.
+    ProbeStats probe_stats() const {
+        ProbeStats ps;
+        ps.keys = size_;
+        ps.capacity = slots_.size();
+        std::vector<std::uint64_t> hashes, homes;
+        hashes.reserve(size_);
+        homes.reserve(size_);
+        for (std::size_t i = 0; i < slots_.size(); ++i) {
+            const Slot& s = slots_[i];
+            if (!s.hash) continue;
+            const std::size_t home = index_of(s.hash);
+            const std::size_t d = (i - home) & mask_;
+            ++ps.probe_hist[std::min(d, ProbeStats::kBuckets - 1)];
+            ps.max_probe = std::max(ps.max_probe, d);
+            ps.total_probe += d;
+            hashes.push_back(s.hash);
+            homes.push_back(home);
+        }
+        auto runs = [](std::vector<std::uint64_t>& v, auto&& on_run) {
+            std::sort(v.begin(), v.end());
+            for (std::size_t i = 0, j; i < v.size(); i = j) {
+                for (j = i + 1; j < v.size() && v[j] == v[i]; ++j) {}
+                on_run(j - i);
+            }
+        };
+        runs(hashes, [&](std::size_t n) { if (n > 1) ps.hash_collisions += n; });
+        runs(homes, [&](std::size_t n) { ++ps.home_hist[std::min(n, ProbeStats::kBuckets - 1)]; });
+        return ps;
+    }
+
+private:
+    std::size_t index_of(std::uint64_t h) const noexcept {
+        return static_cast<std::size_t>(((h ^ (h >> 29)) * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void set_capacity(std::size_t cap) noexcept {
+        mask_ = cap - 1;
+        shift_ = 64 - static_cast<unsigned>(__builtin_ctzll(cap));
+    }
+
+    // Calls f on every slot of t whose key falls in shard k of 2^bits: the
+    // k-th slot range, then on through the probe run crossing its end.
+    template <class F>
+    static void scan_shard(const StationTable& t, unsigned k, unsigned bits, F&& f) {
+        const std::size_t cap = t.slots_.size();
+        const std::size_t lo = (cap >> bits) * k, hi = lo + (cap >> bits);
+        auto mine = [&](std::uint64_t h) { return t.index_of(h) >> (t.log2_capacity() - bits) == k; };
+        for (std::size_t i = lo; i < hi; ++i) {
+            const Slot& s = t.slots_[i];
+            if (s.hash && mine(s.hash)) f(s);
+        }
+        for (std::size_t i = hi & t.mask_; t.slots_[i].hash; i = (i + 1) & t.mask_) {
+            if (mine(t.slots_[i].hash)) f(t.slots_[i]);
+            if (((i + 1) & t.mask_) == lo) break;   // full wrap (cannot happen below load 1)
+        }
+    }
+
+    unsigned log2_capacity() const noexcept { return 64 - shift_; }
+
+    template <class F>
+    static void run_shards(unsigned n, F&& f) {
+        std::vector<std::thread> workers;
+        workers.reserve(n - 1);
+        for (unsigned k = 1; k < n; ++k) workers.emplace_back(f, k);
+        f(0u);
+        for (auto& t : workers) t.join();
+    }
+
+    std::string_view name_of(const Slot& s) const noexcept { return {keys_.at(s.off), s.len}; }
+
+    bool equal(const Slot& s, std::string_view key) const noexcept {
+        if (s.len != key.size()) return false;
+        if constexpr (Slot::kPrefix > 0) {
+            if (key.size() <= Slot::kPrefix) return std::memcmp(s.prefix, key.data(), key.size()) == 0;
+        }
+        return std::memcmp(keys_.at(s.off), key.data(), key.size()) == 0;
+    }
+
+    // Doubles at half load. Worker tables start at 1 << 12 slots and grow
+    // with the station count (three times per thread on a 10k-station input);
+    // each doubling re-homes the keys once, so the total work is linear.
+    void grow() { rehash(slots_.size() * 2); }
+
+    void rehash(std::size_t cap) {
+        SlotVector old(cap);
+        old.swap(slots_);
+        set_capacity(slots_.size());
+        for (Slot& s : old) {
+            if (!s.hash) continue;
+            std::size_t i = index_of(s.hash);
+            while (slots_[i].hash) i = (i + 1) & mask_;
+            slots_[i] = std::move(s);   // results with heap state (ExtendedResult) move, not copy
+        }
+    }
+
+    SlotVector  slots_;
+    KeyArena    keys_;
+    std::size_t mask_ = 0;
+    unsigned    shift_ = 64;
+    std::size_t size_ = 0;
+};